@@ -0,0 +1,200 @@
+#include "AtomicFileWriter.h"
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	// numbers the temporary files of this process, so writers on other threads get names of their own
+	atomic<unsigned> tempCount(0);
+	const int TEMP_TRIES = 100;
+	const char TEMP_SUFFIX[] = ".wurd-save";
+
+	string directoryOf(const string &path)
+	{
+		size_t slash = path.rfind('/');
+		return slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+	}
+
+	// A process that dies between open() and commit() leaves its temporary file behind. Remove those
+	// beside path whose process has gone; a live one's may be a save still being written. O(files in
+	// the directory), once per save.
+	void removeStaleTemps(const string &path)
+	{
+		DIR *dir = opendir(directoryOf(path).c_str());
+		if (dir == nullptr)
+		{
+			return;
+		}
+		string prefix = path.substr(path.rfind('/') + 1) + TEMP_SUFFIX;
+		while (dirent *entry = readdir(dir))
+		{
+			const char *name = entry->d_name;
+			char *end;
+			if (strncmp(name, prefix.c_str(), prefix.size()) != 0 || !isdigit(static_cast<unsigned char>(name[prefix.size()])))
+			{
+				continue;
+			}
+			long pid = strtol(name + prefix.size(), &end, 10);
+			if (*end != '-' || !isdigit(static_cast<unsigned char>(end[1])) || pid <= 0 || pid == getpid())
+			{
+				continue;
+			}
+			strtoul(end + 1, &end, 10);
+			if (*end == '\0' && kill(pid, 0) != 0 && errno == ESRCH)
+			{
+				unlinkat(dirfd(dir), name, 0);
+			}
+		}
+		closedir(dir);
+	}
+}
+
+AtomicFileWriter::AtomicFileWriter()
+	: m_fd(-1), m_used(0), m_failed(false)
+{
+}
+
+AtomicFileWriter::~AtomicFileWriter()
+{
+	abandon();
+}
+
+bool AtomicFileWriter::open(const std::string &path)
+{
+	abandon();
+
+	// write through a symlink to the file it names; a path that doesn't exist yet is used as is
+	char resolved[PATH_MAX];
+	m_path = realpath(path.c_str(), resolved) != nullptr ? resolved : path;
+	removeStaleTemps(m_path);
+
+	// created with the usual 0666 less the umask, unless there is an old file to copy the mode from.
+	// The name is this process's and this writer's own; one that is taken may be another writer's
+	// still being filled, so it is never removed, only passed over
+	struct stat old;
+	bool replacing = stat(m_path.c_str(), &old) == 0;
+	for (int tries = 0; m_fd < 0 && tries < TEMP_TRIES; ++tries)
+	{
+		m_tempPath = m_path + TEMP_SUFFIX + to_string(getpid()) + "-" + to_string(tempCount++);
+		m_fd = ::open(m_tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+		if (m_fd < 0 && errno != EEXIST)
+		{
+			break;
+		}
+	}
+	if (m_fd < 0)
+	{
+		return false;
+	}
+	if (replacing)
+	{
+		fchmod(m_fd, old.st_mode & 07777);
+	}
+
+	m_buffer.resize(BUFFER_SIZE);
+	m_used = 0;
+	m_failed = false;
+	return true;
+}
+
+void AtomicFileWriter::write(std::string_view data)
+{
+	// small writes are copied into the buffer; one that doesn't fit in it goes straight out
+	if (m_fd < 0 || m_failed)
+	{
+		return;
+	}
+	if (data.size() > m_buffer.size() - m_used)
+	{
+		if (!flush())
+		{
+			return;
+		}
+		if (data.size() >= m_buffer.size())
+		{
+			writeOut(data.data(), data.size());
+			return;
+		}
+	}
+	memcpy(m_buffer.data() + m_used, data.data(), data.size());
+	m_used += data.size();
+}
+
+bool AtomicFileWriter::commit()
+{
+	if (m_fd < 0)
+	{
+		return false;
+	}
+
+	// the data has to be on disk before the rename makes it the file, or a crash could leave the
+	// name pointing at an empty one
+	bool ok = !m_failed && flush() && fsync(m_fd) == 0;
+	ok = ::close(m_fd) == 0 && ok;
+	m_fd = -1;
+	if (!ok || rename(m_tempPath.c_str(), m_path.c_str()) != 0)
+	{
+		unlink(m_tempPath.c_str());
+		return false;
+	}
+
+	// and the rename has to be on disk for the save to survive a crash
+	int dirFd = ::open(directoryOf(m_path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirFd >= 0)
+	{
+		fsync(dirFd);
+		::close(dirFd);
+	}
+	return true;
+}
+
+void AtomicFileWriter::abandon()
+{
+	if (m_fd >= 0)
+	{
+		::close(m_fd);
+		unlink(m_tempPath.c_str());
+		m_fd = -1;
+	}
+	m_used = 0;
+}
+
+bool AtomicFileWriter::flush()
+{
+	bool ok = writeOut(m_buffer.data(), m_used);
+	m_used = 0;
+	return ok;
+}
+
+bool AtomicFileWriter::writeOut(const char *data, size_t size)
+{
+	// write() may stop short, or be interrupted before writing anything
+	while (size > 0)
+	{
+		ssize_t wrote = ::write(m_fd, data, size);
+		if (wrote < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (wrote <= 0)
+		{
+			m_failed = true;
+			return false;
+		}
+		data += wrote;
+		size -= wrote;
+	}
+	return true;
+}
@@ -0,0 +1,46 @@
+#ifndef ATOMICFILEWRITER_H_
+#define ATOMICFILEWRITER_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Replaces a file all at once. Writes go to a temporary file beside the target, named for the process
+// and the writer so that no two writers share one, through a large buffer, so a write() is made per
+// BUFFER_SIZE bytes rather than per line; commit() flushes it, fsyncs it and renames it over the
+// target, then fsyncs the directory. Until then the target is untouched, and after a crash it is
+// either the old file or the new one, never a mix. The new file keeps the old one's permissions, and
+// a symlink is followed rather than replaced. A failed or abandoned save deletes its temporary file;
+// one left by a process that crashed is deleted by the next save of the same file.
+class AtomicFileWriter
+{
+public:
+	AtomicFileWriter();
+	~AtomicFileWriter(); // abandons an uncommitted file
+
+	bool open(const std::string &path);
+	// errors are remembered and reported by commit()
+	void write(std::string_view data);
+	bool commit();
+	// delete the temporary file and leave the target as it was
+	void abandon();
+
+private:
+	static const size_t BUFFER_SIZE = 1 << 20;
+
+	std::string m_path; // the target, with symlinks resolved
+	std::string m_tempPath;
+	int m_fd;
+	std::vector<char> m_buffer;
+	size_t m_used;
+	bool m_failed;
+
+	bool flush();
+	bool writeOut(const char *data, size_t size);
+
+	AtomicFileWriter(const AtomicFileWriter &) = delete;
+	AtomicFileWriter &operator=(const AtomicFileWriter &) = delete;
+};
+
+#endif // ATOMICFILEWRITER_H_
@@ -0,0 +1,37 @@
+#include "ByteClassifier.h"
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+ByteClassifier::ByteClassifier(Classify scalar, Classify sse2, Classify avx2)
+	: m_classify(scalar), m_name("scalar")
+{
+	const char *cap = getenv("WURD_SIMD");
+	bool allowSse2 = cap == nullptr || strcmp(cap, "scalar") != 0;
+	bool allowAvx2 = allowSse2 && (cap == nullptr || strcmp(cap, "sse2") != 0);
+#ifdef BYTECLASSIFIER_X86
+	__builtin_cpu_init();
+	if (avx2 != nullptr && allowAvx2 && __builtin_cpu_supports("avx2"))
+	{
+		m_classify = avx2;
+		m_name = "avx2";
+	}
+	else if (sse2 != nullptr && allowSse2 && __builtin_cpu_supports("sse2"))
+	{
+		m_classify = sse2;
+		m_name = "sse2";
+	}
+#endif
+}
+
+uint64_t ByteClassifier::classifyTail(const char *data, size_t size, size_t block) const
+{
+	// the tail is padded with NULs, so loads never run past the data
+	char padded[BLOCK] = {0};
+	if (block < size)
+	{
+		memcpy(padded, data + block, size - block);
+	}
+	return m_classify(padded);
+}
@@ -0,0 +1,56 @@
+#ifndef BYTECLASSIFIER_H_
+#define BYTECLASSIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BYTECLASSIFIER_X86 1
+#endif
+
+// Turns the bytes a scanner is looking for into a bitmask, 64 at a time, with the fastest of the
+// classifiers it is given that the CPU can run: AVX2, SSE2 or a plain loop, chosen once when it is
+// made. Setting WURD_SIMD to "scalar" or "sse2" caps the choice, so they can be tested against each
+// other. Scanners read positions off each mask with lowestBit(), so a block with nothing in it costs
+// one classify and a test.
+class ByteClassifier
+{
+public:
+	static const size_t BLOCK = 64;
+	typedef uint64_t (*Classify)(const char *block);
+
+	// sse2 and avx2 may be null where the compiler can't target them
+	ByteClassifier(Classify scalar, Classify sse2, Classify avx2);
+
+	// bit i for data[block + i]; bytes past size are classified as NULs
+	uint64_t classify(const char *data, size_t size, size_t block) const
+	{
+		return block + BLOCK <= size ? m_classify(data + block) : classifyTail(data, size, block);
+	}
+	// "avx2", "sse2" or "scalar"
+	const char *name() const { return m_name; }
+
+	// bits must not be 0
+	static int lowestBit(uint64_t bits)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(bits);
+#else
+		int index = 0;
+		while (!(bits & 1))
+		{
+			bits >>= 1;
+			++index;
+		}
+		return index;
+#endif
+	}
+
+private:
+	Classify m_classify;
+	const char *m_name;
+
+	uint64_t classifyTail(const char *data, size_t size, size_t block) const;
+};
+
+#endif // BYTECLASSIFIER_H_
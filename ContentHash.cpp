@@ -0,0 +1,88 @@
+#include "ContentHash.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+	const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+	const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+
+	uint64_t rotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// in the host's byte order, so a file that stores a hash has to say which that is
+	uint64_t loadWord(const unsigned char *bytes)
+	{
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		return word;
+	}
+}
+
+ContentHash::ContentHash()
+	: m_state(PRIME2), m_length(0), m_pendingSize(0)
+{
+}
+
+void ContentHash::add(std::string_view data)
+{
+	// O(data): finish a word left over from last time, then whole words, and keep what's left
+	if (data.empty())
+	{
+		return;
+	}
+	const unsigned char *pos = reinterpret_cast<const unsigned char *>(data.data());
+	const unsigned char *end = pos + data.size();
+	m_length += data.size();
+	if (m_pendingSize > 0)
+	{
+		size_t taking = min(static_cast<size_t>(end - pos), sizeof(m_pending) - m_pendingSize);
+		memcpy(m_pending + m_pendingSize, pos, taking);
+		m_pendingSize += taking;
+		pos += taking;
+		if (m_pendingSize < sizeof(m_pending))
+		{
+			return;
+		}
+		mix(loadWord(m_pending));
+		m_pendingSize = 0;
+	}
+	for (; end - pos >= 8; pos += 8)
+	{
+		mix(loadWord(pos));
+	}
+	memcpy(m_pending, pos, end - pos);
+	m_pendingSize = end - pos;
+}
+
+uint64_t ContentHash::value() const
+{
+	// the last part word, zero-padded, and the length, then mixed until every bit of the state
+	// affects every bit of the result
+	unsigned char last[8] = {};
+	memcpy(last, m_pending, m_pendingSize);
+	uint64_t hash = m_state ^ (loadWord(last) * PRIME1);
+	hash ^= m_length;
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+uint64_t ContentHash::of(std::string_view data)
+{
+	ContentHash hash;
+	hash.add(data);
+	return hash.value();
+}
+
+void ContentHash::mix(uint64_t word)
+{
+	m_state = rotateLeft(m_state ^ (word * PRIME2), 31) * PRIME1;
+}
@@ -0,0 +1,31 @@
+#ifndef CONTENTHASH_H_
+#define CONTENTHASH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// A 64-bit hash of bytes fed in pieces of any size: the same bytes hash the same however they are
+// split. It takes them eight at a time, so hashing a whole document is cheap next to reading it. Not
+// cryptographic; it is for telling whether a file is the one something was saved with.
+class ContentHash
+{
+public:
+	ContentHash();
+
+	void add(std::string_view data);
+	uint64_t value() const;
+
+	// the hash of data in one piece
+	static uint64_t of(std::string_view data);
+
+private:
+	uint64_t m_state;
+	uint64_t m_length;
+	unsigned char m_pending[8]; // the bytes of a word not yet complete
+	size_t m_pendingSize;
+
+	void mix(uint64_t word);
+};
+
+#endif // CONTENTHASH_H_
@@ -0,0 +1,204 @@
+#include "DaemonSpellCheck.h"
+#include "DictImage.h"
+#include <climits>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+SpellCheck *createSpellCheck()
+{
+	return new DaemonSpellCheck;
+}
+
+DaemonSpellCheck::DaemonSpellCheck()
+	: m_remote(false)
+{
+}
+
+DaemonSpellCheck::~DaemonSpellCheck()
+{
+}
+
+bool DaemonSpellCheck::load(std::string dictionaryFile)
+{
+	m_dictionaryFile = dictionaryFile;
+	m_lineCache.clear();
+
+	// prefer the shared daemon; load in-process only if it can't serve this dictionary
+	m_remote = connectDaemon(dictionaryFile);
+	return m_remote || m_local.load(dictionaryFile);
+}
+
+bool DaemonSpellCheck::spellCheck(std::string word, int max_suggestions, std::vector<std::string> &suggestions)
+{
+	bool correct = spellCheck(string_view(word), max_suggestions, m_suggestions);
+	suggestions.clear();
+	for (int i = 0; i < m_suggestions.size(); ++i)
+	{
+		suggestions.emplace_back(m_suggestions[i]);
+	}
+	return correct;
+}
+
+void DaemonSpellCheck::spellCheckLine(const std::string &line, std::vector<SpellCheck::Position> &problems)
+{
+	spellCheckLine(string_view(line), problems);
+}
+
+bool DaemonSpellCheck::spellCheck(std::string_view word, int max_suggestions, SuggestionBuffer &suggestions)
+{
+	bool correct;
+	if (m_remote && request(SPELL_SUGGEST, word, max_suggestions) && decodeSuggestions(m_response, correct, suggestions))
+	{
+		return correct;
+	}
+
+	fallBack();
+	return m_local.spellCheck(word, max_suggestions, suggestions);
+}
+
+void DaemonSpellCheck::spellCheckLine(std::string_view line, std::vector<SpellCheck::Position> &problems)
+{
+	if (!m_lineCache.find(line, problems))
+	{
+		checkLine(line, problems);
+		m_lineCache.insert(line, problems);
+	}
+}
+
+void DaemonSpellCheck::checkLine(std::string_view line, std::vector<SpellCheck::Position> &problems)
+{
+	if (m_remote && request(SPELL_CHECK_LINE, line, 0) && decodePositions(m_response, problems))
+	{
+		return;
+	}
+
+	fallBack();
+	m_local.spellCheckLine(line, problems);
+}
+
+void DaemonSpellCheck::spellCheckDocument(const std::vector<std::string> &lines, std::vector<std::vector<SpellCheck::Position>> &problems)
+{
+	problems.resize(lines.size());
+	size_t done = 0;
+	while (m_remote && done < lines.size())
+	{
+		size_t end = checkWindow(lines, done, problems);
+		if (end == done)
+		{
+			break;
+		}
+		done = end;
+	}
+	if (done == lines.size())
+	{
+		return;
+	}
+
+	fallBack();
+	m_local.spellCheckDocument(lines, problems);
+}
+
+std::string DaemonSpellCheck::statistics() const
+{
+	const LineCheckCache::Stats &stats = m_lineCache.stats();
+	return string(m_remote ? "wurdd" : "in-process") + " checker; line cache: " + to_string(stats.hits) + " hits, " +
+		to_string(stats.misses) + " misses, " + to_string(stats.evictions) + " evicted";
+}
+
+bool DaemonSpellCheck::connectDaemon(const std::string &dictionaryFile)
+{
+	// the daemon has to be serving this exact file, unchanged since it loaded it
+	char resolved[PATH_MAX];
+	DictStamp stamp;
+	if (realpath(dictionaryFile.c_str(), resolved) == nullptr || !statDictSource(resolved, stamp))
+	{
+		return false;
+	}
+	if (!m_connection.connect(defaultSpellSocketPath()) || !request(SPELL_HELLO, "", 0))
+	{
+		return false;
+	}
+
+	uint64_t size;
+	int64_t mtime;
+	string path;
+	if (!decodeHello(m_response, size, mtime, path) || path != resolved || size != stamp.size || mtime != stamp.mtime)
+	{
+		m_connection.close();
+		return false;
+	}
+	return true;
+}
+
+bool DaemonSpellCheck::request(SpellOp op, std::string_view payload, int maxSuggestions)
+{
+	// one round trip; any failure drops the connection for good
+	if (!m_connection.isOpen())
+	{
+		return false;
+	}
+
+	SpellResponseHeader header;
+	uint32_t id = m_connection.send(op, payload, maxSuggestions);
+	if (!m_connection.flush() || !m_connection.receive(header, m_response) || header.id != id || header.status != SPELL_OK)
+	{
+		m_connection.close();
+		return false;
+	}
+	return true;
+}
+
+size_t DaemonSpellCheck::checkWindow(const std::vector<std::string> &lines, size_t begin, std::vector<std::vector<SpellCheck::Position>> &problems)
+{
+	// returns the end of the window checked, or begin if the connection failed (and was dropped)
+	if (!m_connection.isOpen())
+	{
+		return begin;
+	}
+
+	size_t end = begin;
+	size_t bytes = 0;
+	uint32_t firstId = 0;
+	while (end < lines.size() && end - begin < WINDOW_LINES && bytes < WINDOW_BYTES)
+	{
+		uint32_t id = m_connection.send(SPELL_CHECK_LINE, lines[end]);
+		if (end == begin)
+		{
+			firstId = id;
+		}
+		bytes += lines[end].size();
+		++end;
+	}
+	if (!m_connection.flush())
+	{
+		m_connection.close();
+		return begin;
+	}
+
+	SpellResponseHeader header;
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (!m_connection.receive(header, m_response) || header.id != firstId + (i - begin) ||
+			header.status != SPELL_OK || !decodePositions(m_response, problems[i]))
+		{
+			m_connection.close();
+			return begin;
+		}
+	}
+	return end;
+}
+
+void DaemonSpellCheck::fallBack()
+{
+	// the daemon went away mid-session, so load the dictionary in-process from now on
+	if (m_remote)
+	{
+		m_remote = false;
+		m_connection.close();
+		m_local.load(m_dictionaryFile);
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef DAEMONSPELLCHECK_H_
+#define DAEMONSPELLCHECK_H_
+
+#include "LineCheckCache.h"
+#include "SpellCheck.h"
+#include "SpellProtocol.h"
+#include "StudentSpellCheck.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A thin client for wurdd, so every session on a machine shares one loaded dictionary. If no daemon
+// is serving the requested dictionary, or the daemon goes away mid-session, the dictionary is loaded
+// in-process and checked locally instead.
+class DaemonSpellCheck : public SpellCheck
+{
+public:
+	DaemonSpellCheck();
+	virtual ~DaemonSpellCheck();
+	bool load(std::string dict_file);
+	bool spellCheck(std::string word, int maxSuggestions, std::vector<std::string> &suggestions);
+	void spellCheckLine(const std::string &line, std::vector<Position> &problems);
+	bool spellCheck(std::string_view word, int maxSuggestions, SuggestionBuffer &suggestions);
+	void spellCheckLine(std::string_view line, std::vector<Position> &problems);
+	void spellCheckDocument(const std::vector<std::string> &lines, std::vector<std::vector<Position>> &problems);
+	std::string statistics() const;
+
+	// hits and misses of the line cache in front of spellCheckLine()
+	const LineCheckCache::Stats &lineCacheStats() const { return m_lineCache.stats(); }
+
+private:
+	// a document goes to the daemon in windows of pipelined lines: few round trips, yet small enough
+	// that neither side can fill its socket buffer while the other is still writing
+	static const size_t WINDOW_LINES = 256;
+	static const size_t WINDOW_BYTES = 32 * 1024;
+
+	SpellConnection m_connection;
+	StudentSpellCheck m_local;
+	std::string m_dictionaryFile;
+	bool m_remote; // answers come from the daemon rather than m_local
+	std::string m_response;
+	SuggestionBuffer m_suggestions; // reused by the std::vector form of spellCheck
+	LineCheckCache m_lineCache;		// a redraw mostly re-checks lines it checked last time
+
+	bool connectDaemon(const std::string &dictionaryFile);
+	void checkLine(std::string_view line, std::vector<Position> &problems);
+	bool request(SpellOp op, std::string_view payload, int maxSuggestions);
+	size_t checkWindow(const std::vector<std::string> &lines, size_t begin, std::vector<std::vector<Position>> &problems);
+	void fallBack();
+};
+
+#endif // DAEMONSPELLCHECK_H_
@@ -0,0 +1,148 @@
+#include "DictImage.h"
+#include "AtomicFileWriter.h"
+#include "ContentHash.h"
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace
+{
+	const char MAGIC[8] = {'W', 'U', 'R', 'D', 'D', 'I', 'C', 'T'};
+	const uint32_t ORDER_MARK = 0x01020304; // reads back differently on a machine of the other endianness
+	const uint32_t HAS_FREQUENCIES = 1;		// header flag: words carry frequency classes
+
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t nodeCount;
+		uint64_t sourceSize;
+		int64_t sourceMtime;
+		uint64_t checksum; // of the node array
+		uint32_t flags;
+		uint32_t reserved; // keeps the node array 8-byte aligned
+	};
+}
+
+bool statDictSource(const std::string &path, DictStamp &stamp)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+	{
+		return false;
+	}
+
+	stamp.size = info.st_size;
+#ifdef __APPLE__
+	stamp.mtime = info.st_mtimespec.tv_sec * 1000000000ll + info.st_mtimespec.tv_nsec;
+#else
+	stamp.mtime = info.st_mtim.tv_sec * 1000000000ll + info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+std::string dictCachePath(const std::string &wordListPath)
+{
+	return wordListPath + ".wdict";
+}
+
+bool readWordList(const std::string &path, std::vector<std::string> &words)
+{
+	// O(N): read the whole file at once, then split it
+	ifstream infile(path, ios::binary);
+	if (!infile)
+	{
+		return false;
+	}
+	string contents((istreambuf_iterator<char>(infile)), istreambuf_iterator<char>());
+
+	words.clear();
+	string word;
+	for (int i = 0; i <= contents.size(); ++i)
+	{
+		// end of line (or file) finishes the current word
+		if (i == contents.size() || contents[i] == '\n')
+		{
+			if (!word.empty())
+			{
+				words.push_back(word);
+				word.clear();
+			}
+		}
+		// strip nonalpha non apostrophe chars
+		else if (isalpha(static_cast<unsigned char>(contents[i])) || contents[i] == '\'')
+		{
+			word += toupper(static_cast<unsigned char>(contents[i]));
+		}
+	}
+
+	return true;
+}
+
+bool writeDictImage(const std::string &path, const FlatTrie &trie, const DictStamp &stamp)
+{
+	Header header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = DICT_IMAGE_VERSION;
+	header.byteOrder = ORDER_MARK;
+	header.nodeCount = trie.size();
+	header.sourceSize = stamp.size;
+	header.sourceMtime = stamp.mtime;
+	string_view nodes(reinterpret_cast<const char *>(trie.data()), trie.size() * sizeof(FlatTrie::Node));
+	header.checksum = ContentHash::of(nodes);
+	header.flags = trie.hasFrequencies() ? HAS_FREQUENCIES : 0;
+	header.reserved = 0;
+
+	// replaced all at once, so readers never see a partial image
+	AtomicFileWriter out;
+	if (!out.open(path))
+	{
+		return false;
+	}
+	out.write(string_view(reinterpret_cast<const char *>(&header), sizeof(header)));
+	out.write(nodes);
+	return out.commit();
+}
+
+bool mapDictImage(const std::string &path, const DictStamp *expected, MappedFile &image, FlatTrie &trie)
+{
+	MappedFile mapped;
+	if (!mapped.open(path) || mapped.size() < sizeof(Header))
+	{
+		return false;
+	}
+
+	// check header before trusting anything after it
+	Header header;
+	memcpy(&header, mapped.data(), sizeof(header));
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != DICT_IMAGE_VERSION ||
+		header.byteOrder != ORDER_MARK || header.nodeCount == 0 ||
+		mapped.size() != sizeof(Header) + header.nodeCount * sizeof(FlatTrie::Node))
+	{
+		return false;
+	}
+
+	// stale if the word list changed since this image was compiled
+	if (expected != nullptr && (header.sourceSize != expected->size || header.sourceMtime != expected->mtime))
+	{
+		return false;
+	}
+
+	const FlatTrie::Node *nodes = reinterpret_cast<const FlatTrie::Node *>(mapped.data() + sizeof(Header));
+	if (ContentHash::of(string_view(mapped.data() + sizeof(Header), header.nodeCount * sizeof(FlatTrie::Node))) != header.checksum)
+	{
+		return false;
+	}
+
+	trie.attach(nodes, header.nodeCount, (header.flags & HAS_FREQUENCIES) != 0);
+	image.swap(mapped);
+	return true;
+}
@@ -0,0 +1,39 @@
+#ifndef DICTIMAGE_H_
+#define DICTIMAGE_H_
+
+// Compiled dictionary images: a FlatTrie's node array written behind a small versioned, checksummed
+// header, so a dictionary can be memory-mapped and queried in place with no parsing. An image compiled
+// from a word list records the list's size and modification time, which is how a cached image next to
+// a plain-text dictionary is recognised as stale.
+
+#include "FlatTrie.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct DictStamp
+{
+	uint64_t size;
+	int64_t mtime; // nanoseconds
+};
+
+const uint32_t DICT_IMAGE_VERSION = 3;
+
+// Identify the word list an image is compiled from. Returns false if the file can't be stat'ed.
+bool statDictSource(const std::string &path, DictStamp &stamp);
+
+// Where the compiled image for a plain-text word list is cached.
+std::string dictCachePath(const std::string &wordListPath);
+
+// Read a word list, one word per line, keeping only letters and apostrophes, upper-cased.
+bool readWordList(const std::string &path, std::vector<std::string> &words);
+
+// Write trie to path as an image stamped with its source. The file is replaced atomically.
+bool writeDictImage(const std::string &path, const FlatTrie &trie, const DictStamp &stamp);
+
+// Map the image at path and attach trie to it. If expected is non-null, the image must have been
+// compiled from a source with that stamp. On failure trie and image are left untouched.
+bool mapDictImage(const std::string &path, const DictStamp *expected, MappedFile &image, FlatTrie &trie);
+
+#endif // DICTIMAGE_H_
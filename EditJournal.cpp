@@ -0,0 +1,547 @@
+#include "EditJournal.h"
+#include "AtomicFileWriter.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	const char JOURNAL_MAGIC[8] = {'W', 'U', 'R', 'D', 'J', 'R', 'N', 'L'};
+	const char SNAPSHOT_MAGIC[8] = {'W', 'U', 'R', 'D', 'S', 'N', 'A', 'P'};
+	const uint32_t JOURNAL_VERSION = 3;
+	const uint32_t ORDER_MARK = 0x01020304; // reads back differently on a machine of the other endianness
+	const uint32_t FROM_SNAPSHOT = 1;		// journal flag: the edits apply to the snapshot, not the file
+
+	struct JournalHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t generation;
+		uint32_t flags;
+		uint32_t reserved;
+		uint64_t baseSize; // of the file, when the journal starts from it
+		int64_t baseMtime; // nanoseconds
+	};
+
+	struct SnapshotHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t generation;
+		uint64_t textSize;
+		uint64_t baseSize; // of the file the edits in it were made to
+		int64_t baseMtime;
+	};
+
+	// each record is its payload's size and checksum, then the payload: op, row, col and count, then
+	// the inserted text if any
+	const size_t RECORD_HEADER = 8;
+	const size_t PAYLOAD_FIELDS = 13;
+
+	const string_view NEWLINE = "\n";
+
+	// the low half of a ContentHash is plenty to catch a torn or unwritten tail
+	uint32_t checksum(string_view fields, string_view text = string_view())
+	{
+		ContentHash hash;
+		hash.add(fields);
+		hash.add(text);
+		return static_cast<uint32_t>(hash.value());
+	}
+
+	bool syncData(int fd)
+	{
+#ifdef __APPLE__
+		return fsync(fd) == 0;
+#else
+		return fdatasync(fd) == 0;
+#endif
+	}
+
+	bool readFile(const string &path, string &contents)
+	{
+		ifstream infile(path, ios::binary);
+		if (!infile)
+		{
+			return false;
+		}
+		contents.assign(istreambuf_iterator<char>(infile), istreambuf_iterator<char>());
+		return true;
+	}
+}
+
+EditJournal::EditJournal()
+	: m_buffer(nullptr), m_baseSize(0), m_baseMtime(0), m_sinceSnapshot(0), m_journalBytes(0), m_documentBytes(0),
+	  m_stopping(false), m_fd(-1), m_generation(0), m_writeFailed(false)
+{
+}
+
+EditJournal::~EditJournal()
+{
+	stop();
+}
+
+bool EditJournal::start(const std::string &path, const TextBuffer &buffer)
+{
+	if (!open(path, buffer))
+	{
+		return false;
+	}
+
+	// whatever an earlier session left is stale now
+	removeFiles();
+	run();
+	return true;
+}
+
+bool EditJournal::recover(const std::string &path, TextBuffer &buffer, int &row, int &col)
+{
+	if (!open(path, buffer) || !replay(buffer, row, col))
+	{
+		m_journalPath.clear();
+		m_snapshotPath.clear();
+		m_buffer = nullptr;
+		return false;
+	}
+
+	// the recovered edits aren't saved anywhere but the old journal yet; a snapshot of a newer
+	// generation takes its place
+	run();
+	snapshot();
+	return true;
+}
+
+void EditJournal::stop()
+{
+	if (active())
+	{
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wake.notify_one();
+		m_thread.join();
+	}
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+	if (!m_journalPath.empty())
+	{
+		removeFiles();
+	}
+
+	m_tasks.clear();
+	m_journalPath.clear();
+	m_snapshotPath.clear();
+	m_buffer = nullptr;
+}
+
+void EditJournal::insert(int row, int col, std::string_view text)
+{
+	record(INSERT, row, col, text.size(), text);
+}
+
+void EditJournal::erase(int row, int col, int count)
+{
+	record(ERASE, row, col, count, string_view());
+}
+
+void EditJournal::split(int row, int col)
+{
+	record(SPLIT, row, col, 0, string_view());
+}
+
+void EditJournal::join(int row)
+{
+	record(JOIN, row, 0, 0, string_view());
+}
+
+void EditJournal::record(Op op, int row, int col, int count, std::string_view text)
+{
+	// O(1) plus the text: the record is queued for the writer, which does the I/O
+	if (!active())
+	{
+		return;
+	}
+
+	char fields[PAYLOAD_FIELDS];
+	int32_t values[3] = {row, col, count};
+	fields[0] = op;
+	memcpy(fields + 1, values, sizeof(values));
+	uint32_t header[2];
+	header[0] = PAYLOAD_FIELDS + text.size();
+	header[1] = checksum(string_view(fields, PAYLOAD_FIELDS), text);
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_tasks.empty() || m_tasks.back().snapshot)
+		{
+			m_tasks.emplace_back();
+			m_tasks.back().snapshot = false;
+		}
+		string &records = m_tasks.back().records;
+		records.append(reinterpret_cast<const char *>(header), RECORD_HEADER);
+		records.append(fields, PAYLOAD_FIELDS);
+		records.append(text.data(), text.size());
+	}
+	m_wake.notify_one();
+
+	m_journalBytes += RECORD_HEADER + PAYLOAD_FIELDS + text.size();
+	if (++m_sinceSnapshot >= SNAPSHOT_RECORDS && m_journalBytes >= m_documentBytes)
+	{
+		snapshot();
+	}
+}
+
+void EditJournal::snapshot()
+{
+	// O(lines) here, and the writer does the rest; see the class comment for how seldom. Unedited
+	// runs are passed as views into the loaded text, which outlives them: it is only replaced by a
+	// load or clear, and those stop the journal first. Edited lines can change under the writer, so
+	// they are copied
+	Task task;
+	task.snapshot = true;
+	m_documentBytes = 0;
+	m_buffer->forEachSpan([&](string_view text) {
+		m_documentBytes += text.size();
+		if (m_buffer->inLoadedText(text))
+		{
+			task.spans.push_back(text);
+		}
+		else if (text == "\n")
+		{
+			// the line end after each line that isn't part of a run
+			task.spans.push_back(NEWLINE);
+		}
+		else
+		{
+			task.copies.emplace_back(text);
+			task.spans.push_back(task.copies.back());
+		}
+	});
+	m_sinceSnapshot = 0;
+	m_journalBytes = 0;
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_wake.notify_one();
+}
+
+void EditJournal::work()
+{
+	unique_lock<mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_wake.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+		if (m_stopping)
+		{
+			// the journal is being thrown away, so whatever is queued doesn't matter
+			return;
+		}
+
+		// group commit: everything queued while the last batch was syncing goes out in one batch,
+		// with one fdatasync
+		deque<Task> tasks;
+		tasks.swap(m_tasks);
+		lock.unlock();
+
+		for (const Task &task : tasks)
+		{
+			if (m_writeFailed)
+			{
+				break;
+			}
+			if (task.snapshot)
+			{
+				m_writeFailed = !writeSnapshot(task);
+			}
+			else
+			{
+				m_writeFailed = !((m_fd >= 0 || createJournal(false)) && append(task.records));
+			}
+		}
+		if (!m_writeFailed && m_fd >= 0 && !syncData(m_fd))
+		{
+			m_writeFailed = true;
+		}
+		tasks.clear();
+		lock.lock();
+	}
+}
+
+bool EditJournal::writeSnapshot(const Task &task)
+{
+	// the snapshot is complete on disk before a journal based on it replaces the old one, and has a
+	// newer generation than that, so recovery prefers it to the old journal in between
+	++m_generation;
+	SnapshotHeader header;
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	header.version = JOURNAL_VERSION;
+	header.byteOrder = ORDER_MARK;
+	header.generation = m_generation;
+	header.textSize = 0;
+	header.baseSize = m_baseSize;
+	header.baseMtime = m_baseMtime;
+	for (string_view span : task.spans)
+	{
+		header.textSize += span.size();
+	}
+
+	AtomicFileWriter out;
+	if (!out.open(m_snapshotPath))
+	{
+		return false;
+	}
+	out.write(string_view(reinterpret_cast<const char *>(&header), sizeof(header)));
+	for (string_view span : task.spans)
+	{
+		out.write(span);
+	}
+	return out.commit() && createJournal(true);
+}
+
+bool EditJournal::createJournal(bool fromSnapshot)
+{
+	// a journal starting from the file is a new generation; one starting from a snapshot shares its
+	if (!fromSnapshot)
+	{
+		++m_generation;
+	}
+	JournalHeader header;
+	memcpy(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+	header.version = JOURNAL_VERSION;
+	header.byteOrder = ORDER_MARK;
+	header.generation = m_generation;
+	header.flags = fromSnapshot ? FROM_SNAPSHOT : 0;
+	header.reserved = 0;
+	header.baseSize = m_baseSize;
+	header.baseMtime = m_baseMtime;
+
+	// the header is renamed into place whole, then records are appended to it
+	AtomicFileWriter out;
+	if (!out.open(m_journalPath))
+	{
+		return false;
+	}
+	out.write(string_view(reinterpret_cast<const char *>(&header), sizeof(header)));
+	if (!out.commit())
+	{
+		return false;
+	}
+
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+	}
+	m_fd = ::open(m_journalPath.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+	return m_fd >= 0;
+}
+
+bool EditJournal::append(const std::string &records)
+{
+	const char *data = records.data();
+	size_t size = records.size();
+	while (size > 0)
+	{
+		ssize_t wrote = ::write(m_fd, data, size);
+		if (wrote < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (wrote <= 0)
+		{
+			return false;
+		}
+		data += wrote;
+		size -= wrote;
+	}
+	return true;
+}
+
+bool EditJournal::open(const std::string &path, const TextBuffer &buffer)
+{
+	stop();
+
+	// only a regular file can be told apart from a changed version of itself
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+	{
+		return false;
+	}
+	m_baseSize = info.st_size;
+#ifdef __APPLE__
+	m_baseMtime = info.st_mtimespec.tv_sec * 1000000000ll + info.st_mtimespec.tv_nsec;
+#else
+	m_baseMtime = info.st_mtim.tv_sec * 1000000000ll + info.st_mtim.tv_nsec;
+#endif
+
+	m_journalPath = path + ".wurd-journal";
+	m_snapshotPath = path + ".wurd-snapshot";
+	m_buffer = &buffer;
+	m_sinceSnapshot = 0;
+	m_journalBytes = 0;
+	m_documentBytes = buffer.loadedText().size();
+	m_stopping = false;
+	m_generation = 0;
+	m_writeFailed = false;
+	return true;
+}
+
+void EditJournal::run()
+{
+	m_thread = thread(&EditJournal::work, this);
+}
+
+bool EditJournal::replay(TextBuffer &buffer, int &row, int &col)
+{
+	// the newest of the journal and the snapshot wins; see the class comment
+	string journal;
+	JournalHeader journalHeader;
+	bool haveJournal = readFile(m_journalPath, journal) && journal.size() >= sizeof(JournalHeader);
+	if (haveJournal)
+	{
+		memcpy(&journalHeader, journal.data(), sizeof(journalHeader));
+		haveJournal = memcmp(journalHeader.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) == 0 &&
+					  journalHeader.version == JOURNAL_VERSION && journalHeader.byteOrder == ORDER_MARK;
+	}
+
+	MappedFile snapshot;
+	SnapshotHeader snapshotHeader;
+	bool haveSnapshot = snapshot.open(m_snapshotPath) && snapshot.size() >= sizeof(SnapshotHeader);
+	if (haveSnapshot)
+	{
+		memcpy(&snapshotHeader, snapshot.data(), sizeof(snapshotHeader));
+		haveSnapshot = memcmp(snapshotHeader.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+					   snapshotHeader.version == JOURNAL_VERSION && snapshotHeader.byteOrder == ORDER_MARK &&
+					   snapshotHeader.textSize == snapshot.size() - sizeof(SnapshotHeader);
+	}
+
+	uint64_t journalGeneration = haveJournal ? journalHeader.generation : 0;
+	uint64_t snapshotGeneration = haveSnapshot ? snapshotHeader.generation : 0;
+	string_view snapshotText;
+	if (haveSnapshot)
+	{
+		snapshotText = string_view(snapshot.data() + sizeof(SnapshotHeader), snapshotHeader.textSize);
+	}
+
+	// either way, if the file has been changed since, the edits were made to a version of it that is
+	// gone, and recovering them would throw the change away
+	row = 0;
+	col = 0;
+	if (snapshotGeneration > journalGeneration)
+	{
+		// a crash between writing a snapshot and starting the journal after it
+		if (snapshotHeader.baseSize != m_baseSize || snapshotHeader.baseMtime != m_baseMtime)
+		{
+			return false;
+		}
+		buffer.assign(string(snapshotText));
+		m_generation = snapshotGeneration;
+		return true;
+	}
+	if (!haveJournal || journalHeader.baseSize != m_baseSize || journalHeader.baseMtime != m_baseMtime)
+	{
+		return false;
+	}
+	if (journalHeader.flags & FROM_SNAPSHOT)
+	{
+		if (snapshotGeneration != journalGeneration)
+		{
+			return false;
+		}
+		buffer.assign(string(snapshotText));
+	}
+	m_generation = journalGeneration;
+
+	// O(records): apply them in order, stopping at the first that is torn or doesn't fit the document
+	int replayed = 0;
+	size_t pos = sizeof(JournalHeader);
+	while (journal.size() - pos >= RECORD_HEADER + PAYLOAD_FIELDS)
+	{
+		uint32_t header[2];
+		memcpy(header, journal.data() + pos, RECORD_HEADER);
+		const char *payload = journal.data() + pos + RECORD_HEADER;
+		if (header[0] < PAYLOAD_FIELDS || header[0] > journal.size() - pos - RECORD_HEADER ||
+			checksum(string_view(payload, header[0])) != header[1])
+		{
+			break;
+		}
+		Op op = static_cast<Op>(payload[0]);
+		int32_t values[3];
+		memcpy(values, payload + 1, sizeof(values));
+		int editRow = values[0];
+		int editCol = values[1];
+		int count = values[2];
+		string_view text(payload + PAYLOAD_FIELDS, header[0] - PAYLOAD_FIELDS);
+
+		if (editRow < 0 || !buffer.hasLine(editRow) || editCol < 0 || editCol > buffer.lineLength(editRow))
+		{
+			break;
+		}
+		bool applied = true;
+		switch (op)
+		{
+		case INSERT:
+			buffer.insert(editRow, editCol, text);
+			editCol += text.size();
+			break;
+		case ERASE:
+			applied = count >= 0 && count <= buffer.lineLength(editRow) - editCol;
+			if (applied)
+			{
+				buffer.erase(editRow, editCol, count);
+			}
+			break;
+		case SPLIT:
+			buffer.split(editRow, editCol);
+			++editRow;
+			editCol = 0;
+			break;
+		case JOIN:
+			applied = buffer.hasLine(editRow + 1);
+			if (applied)
+			{
+				editCol = buffer.lineLength(editRow);
+				buffer.join(editRow);
+			}
+			break;
+		default:
+			applied = false;
+			break;
+		}
+		if (!applied)
+		{
+			break;
+		}
+
+		row = editRow;
+		col = editCol;
+		++replayed;
+		pos += RECORD_HEADER + header[0];
+	}
+
+	// a journal based on the file with nothing in it has nothing to recover
+	return replayed > 0 || (journalHeader.flags & FROM_SNAPSHOT);
+}
+
+void EditJournal::removeFiles()
+{
+	unlink(m_journalPath.c_str());
+	unlink(m_snapshotPath.c_str());
+}
@@ -0,0 +1,107 @@
+#ifndef EDITJOURNAL_H_
+#define EDITJOURNAL_H_
+
+#include "TextBuffer.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// A crash-recovery journal for a document being edited: every change made to its TextBuffer since it
+// was loaded or saved is appended to FILE.wurd-journal, so the changes can be replayed after a crash.
+// Recording an edit only queues a few bytes; a thread of the journal's own writes them out, and
+// everything queued while it waits for one fdatasync goes out together with the next. Once the journal
+// holds at least SNAPSHOT_RECORDS edits and has grown as big as the document, the whole document is
+// written to FILE.wurd-snapshot and the journal starts again from it. Replaying then costs no more
+// than reading the document again, and the O(lines) walk a snapshot takes on the editing thread is
+// paid at most once per document's worth of journal, so lightly editing a big file never takes one.
+//
+// Journals and snapshots carry a generation, bumped each time one replaces the other, so whatever
+// point a crash interrupts them at, recovery can tell which is newest. Both record the size and
+// modification time of the file the edits were made to, and are ignored if the file has changed,
+// even though a snapshot holds the whole document: the changed file is the newer text.
+class EditJournal
+{
+public:
+	EditJournal();
+	~EditJournal(); // stops, discarding the journal
+
+	// Start journaling edits to buffer, which holds what is in the file at path, discarding any journal
+	// left there before. False if path isn't a regular file; nothing is journaled then.
+	bool start(const std::string &path, const TextBuffer &buffer);
+	// Apply the edits an earlier session on path made without saving to buffer, just loaded from path,
+	// and carry on journaling from there, as start() would. row and col are where the last of them was
+	// made. False, with buffer untouched and nothing started, if there are none.
+	bool recover(const std::string &path, TextBuffer &buffer, int &row, int &col);
+	// Stop and delete the journal, e.g. because the document was saved or closed.
+	void stop();
+	bool active() const { return m_thread.joinable(); }
+
+	// Each of these follows the TextBuffer call of the same name, once it has been made.
+	void insert(int row, int col, std::string_view text);
+	void erase(int row, int col, int count);
+	void split(int row, int col);
+	void join(int row);
+
+private:
+	static const int SNAPSHOT_RECORDS = 20000;
+
+	enum Op : uint8_t
+	{
+		INSERT = 1,
+		ERASE = 2,
+		SPLIT = 3,
+		JOIN = 4
+	};
+
+	struct Task
+	{
+		bool snapshot; // otherwise records
+		std::string records;
+		std::vector<std::string_view> spans; // of the snapshot: into the loaded text or copies
+		std::deque<std::string> copies;
+	};
+
+	std::string m_journalPath;
+	std::string m_snapshotPath;
+	const TextBuffer *m_buffer;
+	uint64_t m_baseSize; // of the file the journal starts from
+	int64_t m_baseMtime;
+	int m_sinceSnapshot; // edits, and their bytes, journaled since the last snapshot or start
+	uint64_t m_journalBytes;
+	uint64_t m_documentBytes; // as of then
+
+	// shared with the writer
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<Task> m_tasks;
+	bool m_stopping;
+	std::thread m_thread;
+
+	// the writer's own
+	int m_fd;
+	uint64_t m_generation;
+	bool m_writeFailed;
+
+	void record(Op op, int row, int col, int count, std::string_view text);
+	void snapshot();
+	void work();
+	bool writeSnapshot(const Task &task);
+	bool createJournal(bool fromSnapshot);
+	bool append(const std::string &records);
+	bool open(const std::string &path, const TextBuffer &buffer);
+	void run();
+	bool replay(TextBuffer &buffer, int &row, int &col);
+	void removeFiles();
+
+	EditJournal(const EditJournal &) = delete;
+	EditJournal &operator=(const EditJournal &) = delete;
+};
+
+#endif // EDITJOURNAL_H_
@@ -11,6 +11,8 @@
 #include "TextEditor.h"
 #include "SpellCheck.h"
 #include "TextIO.h"
+#include "TextSearch.h"
+#include <algorithm>
 
 class EditorGui {
 public:
@@ -82,7 +84,7 @@ public:
 		if (loaded) {
 			filename_ = filename;
 			resetCursorToTopOfFile();
-			writeStatus("Loaded file successfully!");
+			writeStatus(te_->recovered() ? "Recovered unsaved changes!" : "Loaded file successfully!");
 			redisplayTheEditorWindowAndPositionCursor(false);
 		}
 		else
@@ -156,9 +158,24 @@ private:
 		case CTRL_Z:	// Undo last change
 			te_->undo();
 			break;
+		case CTRL_Y:	// Redo the last change undone
+			te_->redo();
+			break;
+		case CTRL_B:	// Choose which undone change Ctrl-Y redoes
+			nextBranch();
+			return true;
 		case CTRL_D:
 			promptAndLoadDictionary();
 			break;
+		case CTRL_F:	// Find as the pattern is typed
+			find();
+			return true;
+		case CTRL_R:	// Replace every match of a pattern
+			replaceAll();
+			return true;
+		case CTRL_T:	// Show the spell checker's counters
+			showSpellStatistics();
+			return true;
 		case CTRL_X:
 			if (quit()) return false;
 			break;
@@ -175,12 +192,12 @@ private:
 	void prevPage() {
 		int cursor_dist_from_top = getCurDistFromTopRow();
 
-		// Send a cursor up command to the editor for each of the rows on the screen.
-		for (int i = 0; i < rows_; ++i)
-			te_->move(TextEditor::Dir::UP);
+		// Move the cursor up by the number of rows on the screen in a single seek.
+		int cur_row, cur_col;
+		te_->getPos(cur_row, cur_col);
+		te_->moveTo(cur_row - rows_, cur_col);
 
 		// Make sure the GUI positions the cursor on the proper row of the screen.
-		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
 		top_ = cur_row - cursor_dist_from_top;
 		if (top_ < 0) top_ = 0;
@@ -190,12 +207,12 @@ private:
 	void nextPage() {
 		int cursor_dist_from_top = getCurDistFromTopRow();
 
-		// Send a cursor down command to the editor for each of the rows on the screen.
-		for (int i = 0; i < rows_; ++i)
-			te_->move(TextEditor::Dir::DOWN);
+		// Move the cursor down by the number of rows on the screen in a single seek.
+		int cur_row, cur_col;
+		te_->getPos(cur_row, cur_col);
+		te_->moveTo(cur_row + rows_, cur_col);
 
 		// Make sure the GUI positions the cursor on the proper row of the screen.
-		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
 		top_ = cur_row - cursor_dist_from_top;
 		if (top_ < 0) top_ = 0;
@@ -356,13 +373,26 @@ private:
 		}
 	}
 
+	// Mark where the current search matches the line with kMatchChar, over the marks for spelling,
+	// up to the right edge of the screen.
+	// line: The input line from the text editor
+	// prob_str: The pattern from produceBadPattern() to mark the matches in.
+	void produceMatchPattern(const std::string& line, std::string& prob_str) {
+		if (!search_.valid()) return;
+		size_t start, length;
+		size_t shown = static_cast<size_t>(left_) + cols_;
+		for (size_t from = 0; search_.find(line, from, start, length) && start < shown; from = start + length)
+			prob_str.replace(start, length, length, kMatchChar);
+	}
+
 	// Write a line to the console at the specified location, optionally hilighting
-	// misspelled words in red.
+	// misspelled words in red and search matches in reverse video.
 	// row: What row of the screen to print the line on.
 	// line: The line to output
 	void writeLine(int row, const std::string& line) {
 		std::string prob_str;
 		produceBadPattern(line, prob_str);
+		produceMatchPattern(line, prob_str);
 
 		TextIO::move(row, 0);
 		// Determine what to actually print out. Since lines can be very long, we need to compute
@@ -377,9 +407,10 @@ private:
 			print_me.insert(print_me.length(), cols_ - print_me.length(), ' ');
 			prob_str.insert(prob_str.length(), cols_ - prob_str.length(), ' ');
 		}
-		// Print the text in white/red to hilight errors.
+		// Print the text in white/red to hilight errors, and reversed to hilight matches.
 		for (int i = 0; i < print_me.length(); ++i)
-			TextIO::print(print_me[i], prob_str[i] == kBadChar ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
+			TextIO::print(print_me[i], prob_str[i] == kMatchChar ? TextIO::COLOR::MATCH :
+				prob_str[i] == kBadChar ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
 	}
 
 	// Display a prompt and get some input from the user (like a filename) on the status line.
@@ -441,6 +472,101 @@ private:
 		TextIO::move(cur_row, cur_col);
 	}
 
+	// Use pattern as the search to find and hilight; one starting with '/' is a regex.
+	// Returns false if there's nothing to search for (an empty or invalid pattern).
+	bool compileSearch(const std::string& pattern) {
+		if (!pattern.empty() && pattern[0] == '/')
+			return search_.compile(pattern.substr(1), true);
+		return search_.compile(pattern, false);
+	}
+
+	// Find as the user types the pattern on the status line: after each key, the cursor goes to the
+	// first match after where it started, with every match on the screen hilighted. Ctrl-F again goes
+	// on to the next match, Enter stays there (keeping the hilights) and Esc goes back to the start.
+	void find() {
+		int start_row, start_col;
+		te_->getPos(start_row, start_col);
+		const std::string prompt = "Find (/regex): ";
+		std::string pattern;
+		if (search_.valid())
+			pattern = (search_.regex() ? "/" : "") + search_.pattern();
+
+		bool found = true;
+		for (;;) {
+			redisplayTheEditorWindowAndPositionCursor();
+			const std::string status = prompt + pattern + (found || !search_.valid() ? "" : "  [no match]");
+			writeStatus(status.substr(0, cols_));
+			TextIO::move(rows_, std::min(static_cast<int>((prompt + pattern).length()), cols_ - 1));
+
+			int length;
+			const int ch = TextIO::getChar();
+			if (ch == KEY_ENTER) {
+				break;
+			}
+			else if (ch == KEY_ESCAPE) {
+				search_.compile("", false);
+				te_->moveTo(start_row, start_col);
+				break;
+			}
+			else if (ch == CTRL_F) {
+				found = search_.valid() && te_->find(search_, length);
+				continue;
+			}
+			else if (ch == KEY_BACKSPACE) {
+				if (!pattern.empty()) pattern.pop_back();
+			}
+			else if (ch >= ' ' && ch < 127) {
+				pattern += static_cast<char>(ch);
+			}
+			else {
+				continue;
+			}
+
+			// The pattern changed: look again from the start.
+			te_->moveTo(start_row, start_col);
+			found = compileSearch(pattern) && te_->find(search_, length);
+		}
+		redisplayTheEditorWindowAndPositionCursor();
+	}
+
+	// Prompt for a pattern and what to replace it with, then replace every match in one go (which one
+	// Ctrl-Z undoes).
+	void replaceAll() {
+		std::string pattern, replacement;
+		if (!getInput("Replace all (/regex): ", pattern) || !compileSearch(pattern)) {
+			writeStatus("Nothing to replace.");
+			redisplayTheEditorWindowAndPositionCursor(false);
+			return;
+		}
+		getInput("Replace " + pattern + " with: ", replacement);
+		const int replaced = te_->replaceAll(search_, replacement);
+		search_.compile("", false);
+		writeStatus("Replaced " + std::to_string(replaced) + (replaced == 1 ? " match." : " matches."));
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Undoing and then making a different change keeps what was undone as another branch of the
+	// history; this switches which branch Ctrl-Y redoes next.
+	void nextBranch() {
+		const int branch = undo_->nextBranch();
+		if (branch == 0)
+			writeStatus("No other change to redo.");
+		else
+			writeStatus("Redo branch " + std::to_string(branch) + " of " + std::to_string(undo_->branches()) + ".");
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Shows how the spell checker has been answering, e.g. how many lines of redraws its cache saved
+	// it from re-checking.
+	void showSpellStatistics() {
+		const std::string statistics = spell_check_->statistics();
+		if (statistics.empty())
+			writeStatus("No spell-check statistics.");
+		else
+			writeStatus(statistics.substr(0, cols_));
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
 	// Check to see if the user really wants to exit the editor.
 	// Returns true if the user wants to exit, false otherwise.
 	bool quit() {
@@ -459,8 +585,9 @@ private:
 	}
 
 	// Private variables and constants.
-	static const char kGoodChar = ' ', kBadChar = '*';
+	static const char kGoodChar = ' ', kBadChar = '*', kMatchChar = '#';
 	std::string filename_;
+	TextSearch search_;	// what find() last looked for, hilighted while valid
 	TextEditor* te_;
 	Undo* undo_;
 	SpellCheck* spell_check_;
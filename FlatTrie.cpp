@@ -0,0 +1,115 @@
+#include "FlatTrie.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+FlatTrie::FlatTrie()
+{
+	clear();
+}
+
+void FlatTrie::clear()
+{
+	// an empty trie is just a root with no children
+	m_nodes.assign(1, Node{0, 0});
+	m_data = m_nodes.data();
+	m_count = m_nodes.size();
+	m_hasFrequencies = false;
+}
+
+void FlatTrie::attach(const Node *nodes, size_t count, bool hasFrequencies)
+{
+	// drop owned storage; queries now read straight from the borrowed nodes
+	vector<Node>().swap(m_nodes);
+	m_data = nodes;
+	m_count = count;
+	m_hasFrequencies = hasFrequencies;
+}
+
+void FlatTrie::build(std::vector<std::string> &words)
+{
+	// O(N log N): sorting lets every node's children be laid out in one contiguous block
+	sort(words.begin(), words.end());
+	words.erase(unique(words.begin(), words.end()), words.end());
+
+	clear();
+	buildRange(words, 0, words.size(), 0, 0);
+	m_nodes.shrink_to_fit();
+	m_data = m_nodes.data();
+	m_count = m_nodes.size();
+}
+
+int FlatTrie::find(std::string_view word) const
+{
+	// O(L), one array access per char
+	int node = root();
+	for (int i = 0; i < word.size(); ++i)
+	{
+		int letter = letterIndex(word[i]);
+		if (letter < 0)
+		{
+			return NO_NODE;
+		}
+
+		node = child(node, letter);
+		if (node == NO_NODE)
+		{
+			return NO_NODE;
+		}
+	}
+
+	return isWord(node) ? node : NO_NODE;
+}
+
+void FlatTrie::setFrequency(int node, int frequency)
+{
+	m_nodes[node].mask = (m_nodes[node].mask & ~FREQUENCY_MASK) | (static_cast<uint32_t>(frequency) << FREQUENCY_SHIFT);
+	m_hasFrequencies = true;
+}
+
+void FlatTrie::buildRange(const std::vector<std::string> &words, size_t lo, size_t hi, size_t depth, uint32_t node)
+{
+	// words[lo, hi) all share the prefix that leads to node; a word ending here sorts first
+	uint32_t mask = 0;
+	if (lo < hi && words[lo].size() == depth)
+	{
+		mask |= TERMINAL;
+		++lo;
+	}
+
+	// find which letters follow the prefix
+	for (size_t i = lo; i < hi; ++i)
+	{
+		int letter = letterIndex(words[i][depth]);
+		if (letter >= 0)
+		{
+			mask |= 1u << letter;
+		}
+	}
+
+	// reserve one contiguous block for all children (may reallocate, so only keep indices)
+	uint32_t firstChild = m_nodes.size();
+	m_nodes[node].mask = mask;
+	m_nodes[node].firstChild = firstChild;
+	m_nodes.resize(m_nodes.size() + countBits(mask & LETTER_MASK), Node{0, 0});
+
+	// recurse into each run of words sharing the next letter
+	uint32_t childNode = firstChild;
+	for (size_t i = lo; i < hi;)
+	{
+		size_t j = i;
+		while (j < hi && words[j][depth] == words[i][depth])
+		{
+			++j;
+		}
+
+		if (letterIndex(words[i][depth]) >= 0)
+		{
+			buildRange(words, i, j, depth + 1, childNode);
+			++childNode;
+		}
+		i = j;
+	}
+}
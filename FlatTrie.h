@@ -0,0 +1,120 @@
+#ifndef FLATTRIE_H_
+#define FLATTRIE_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A trie stored as one contiguous array of fixed-size nodes. Each node holds a bitmask of the letters
+// it has children for and the index of its first child; the children of a node sit next to each other
+// in letter order, so the child for a letter is found with a popcount instead of a scan.
+// The nodes are either owned (after build()) or borrowed from a compiled image (after attach()).
+class FlatTrie
+{
+public:
+	struct Node
+	{
+		uint32_t mask;		 // bit i set if there is a child for letter i, TERMINAL set if a word ends here,
+							 // and the word's frequency class in the bits between
+		uint32_t firstChild; // index of the child for the lowest letter in mask
+	};
+
+	static const int NUM_LETTERS = 27; // apostrophe, then A-Z (same order as ASCII so sorted words build in order)
+	static const uint32_t LETTER_MASK = (1u << NUM_LETTERS) - 1;
+	static const uint32_t TERMINAL = 1u << 31;
+	static const int FREQUENCY_SHIFT = NUM_LETTERS;
+	static const uint32_t FREQUENCY_MASK = 0xFu << FREQUENCY_SHIFT;
+	static const int MAX_FREQUENCY = 15;
+	static const int NO_NODE = -1;
+
+	FlatTrie();
+
+	// words must already be upper case; they are sorted and deduplicated in place
+	void build(std::vector<std::string> &words);
+	// borrow count nodes laid out by build(), e.g. from a mapped image; they must outlive the trie
+	void attach(const Node *nodes, size_t count, bool hasFrequencies);
+	bool contains(std::string_view word) const { return find(word) != NO_NODE; }
+	// the node where word ends, or NO_NODE if it isn't in the trie
+	int find(std::string_view word) const;
+	void clear();
+
+	// Words can carry a frequency class, 0 (never seen) to MAX_FREQUENCY, for ranking suggestions.
+	// Only an owned trie can be given them.
+	void setFrequency(int node, int frequency);
+	int frequency(int node) const { return (m_data[node].mask & FREQUENCY_MASK) >> FREQUENCY_SHIFT; }
+	bool hasFrequencies() const { return m_hasFrequencies; }
+
+	int root() const { return 0; }
+	int child(int node, int letter) const;
+	bool isWord(int node) const { return (m_data[node].mask & TERMINAL) != 0; }
+	uint32_t letters(int node) const { return m_data[node].mask & LETTER_MASK; }
+	const Node *data() const { return m_data; }
+	size_t size() const { return m_count; }
+
+	static int letterIndex(char ch);
+	static char letterAt(int index);
+	static int lowestLetter(uint32_t letters);
+
+private:
+	std::vector<Node> m_nodes; // storage when the trie was built in memory
+	const Node *m_data;
+	size_t m_count;
+	bool m_hasFrequencies;
+
+	void buildRange(const std::vector<std::string> &words, size_t lo, size_t hi, size_t depth, uint32_t node);
+	static int countBits(uint32_t bits);
+
+	FlatTrie(const FlatTrie &) = delete;
+	FlatTrie &operator=(const FlatTrie &) = delete;
+};
+
+inline int FlatTrie::letterIndex(char ch)
+{
+	// case-insensitive; anything that isn't a letter or apostrophe has no index
+	if (ch >= 'a' && ch <= 'z')
+	{
+		return ch - 'a' + 1;
+	}
+	if (ch >= 'A' && ch <= 'Z')
+	{
+		return ch - 'A' + 1;
+	}
+	return ch == '\'' ? 0 : -1;
+}
+
+inline char FlatTrie::letterAt(int index)
+{
+	return index == 0 ? '\'' : static_cast<char>('A' + index - 1);
+}
+
+inline int FlatTrie::countBits(uint32_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcount(bits);
+#else
+	bits = bits - ((bits >> 1) & 0x55555555);
+	bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+	return static_cast<int>((((bits + (bits >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+#endif
+}
+
+inline int FlatTrie::lowestLetter(uint32_t letters)
+{
+	// index of the lowest set bit; letters must be non-zero
+	return countBits((letters & -letters) - 1);
+}
+
+inline int FlatTrie::child(int node, int letter) const
+{
+	// O(1): the rank of the letter among the node's children is its offset from firstChild
+	uint32_t mask = m_data[node].mask;
+	uint32_t bit = 1u << letter;
+	if (!(mask & bit))
+	{
+		return NO_NODE;
+	}
+	return m_data[node].firstChild + countBits(mask & (bit - 1));
+}
+
+#endif // FLATTRIE_H_
@@ -0,0 +1,88 @@
+#include "GapBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+GapBuffer::GapBuffer(std::pmr::memory_resource *resource)
+	: m_text(resource), m_gapStart(0), m_gapEnd(0)
+{
+}
+
+void GapBuffer::assign(std::pmr::string text)
+{
+	m_text = std::move(text);
+	m_gapStart = m_text.size();
+	m_gapEnd = m_text.size();
+}
+
+std::pmr::string GapBuffer::take()
+{
+	// O(text after the gap)
+	moveGap(size());
+	m_text.resize(m_gapStart);
+	pmr::string text = std::move(m_text);
+	m_text.clear();
+	m_gapStart = 0;
+	m_gapEnd = 0;
+	return text;
+}
+
+void GapBuffer::insert(size_t pos, std::string_view text)
+{
+	// O(text) plus moving the gap to pos; the gap doubles with the text when it runs out
+	moveGap(pos);
+	if (m_gapEnd - m_gapStart < text.size())
+	{
+		size_t tail = m_text.size() - m_gapEnd;
+		size_t grown = max(m_text.size() * 2, m_text.size() + text.size() + MIN_GAP);
+		m_text.resize(grown);
+		memmove(&m_text[grown - tail], &m_text[m_gapEnd], tail);
+		m_gapEnd = grown - tail;
+	}
+	memcpy(&m_text[m_gapStart], text.data(), text.size());
+	m_gapStart += text.size();
+}
+
+void GapBuffer::erase(size_t pos, size_t count)
+{
+	// O(1) plus moving the gap to pos: the erased text joins the gap
+	moveGap(pos);
+	m_gapEnd += count;
+}
+
+std::string GapBuffer::substr(size_t pos, size_t count) const
+{
+	// what lies before the gap, then what lies after it
+	size_t before = pos < m_gapStart ? min(count, m_gapStart - pos) : 0;
+	string text(m_text.data() + pos, before);
+	text.append(m_text.data() + pos + before + (m_gapEnd - m_gapStart), count - before);
+	return text;
+}
+
+std::string_view GapBuffer::text()
+{
+	moveGap(size());
+	return string_view(m_text.data(), m_gapStart);
+}
+
+void GapBuffer::moveGap(size_t pos)
+{
+	// O(distance): the text between pos and the gap moves across it
+	if (pos < m_gapStart)
+	{
+		size_t moving = m_gapStart - pos;
+		memmove(&m_text[m_gapEnd - moving], &m_text[pos], moving);
+		m_gapStart -= moving;
+		m_gapEnd -= moving;
+	}
+	else if (pos > m_gapStart)
+	{
+		size_t moving = pos - m_gapStart;
+		memmove(&m_text[m_gapStart], &m_text[m_gapEnd], moving);
+		m_gapStart += moving;
+		m_gapEnd += moving;
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef GAPBUFFER_H_
+#define GAPBUFFER_H_
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
+// Text with a gap of spare room at the last place it was edited, so a run of inserts or deletes at
+// one spot costs O(1) each (amortized) instead of moving everything after it each time. Moving the
+// gap costs the distance moved. The text is kept in a std::pmr::string, which it is taken from and
+// given back in without copying.
+class GapBuffer
+{
+public:
+	explicit GapBuffer(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
+	// take over text, with the gap at its end; only O(1) if text uses the same memory resource
+	void assign(std::pmr::string text);
+	// give the text back and be left empty
+	std::pmr::string take();
+
+	size_t size() const { return m_text.size() - (m_gapEnd - m_gapStart); }
+	char at(size_t pos) const { return pos < m_gapStart ? m_text[pos] : m_text[pos + (m_gapEnd - m_gapStart)]; }
+	// O(count), leaving the gap where it is
+	std::string substr(size_t pos, size_t count) const;
+
+	void insert(size_t pos, std::string_view text);
+	void erase(size_t pos, size_t count);
+
+	// The text in one piece, which moves the gap to the end. Valid until the next change.
+	std::string_view text();
+
+private:
+	static const size_t MIN_GAP = 64;
+
+	std::pmr::string m_text; // the text before the gap, the gap, then the text after it
+	size_t m_gapStart;
+	size_t m_gapEnd;
+
+	void moveGap(size_t pos);
+};
+
+#endif // GAPBUFFER_H_
@@ -0,0 +1,105 @@
+#include "LineCheckCache.h"
+#include "ContentHash.h"
+#include <algorithm>
+
+using namespace std;
+
+LineCheckCache::LineCheckCache(size_t capacity)
+	: m_capacity(max<size_t>(capacity, 1)), m_newest(NONE), m_oldest(NONE), m_stats{0, 0, 0}
+{
+}
+
+bool LineCheckCache::find(std::string_view line, std::vector<SpellCheck::Position> &problems)
+{
+	// O(L) to hash the line and compare it, O(1) otherwise
+	auto found = m_index.find(ContentHash::of(line));
+	if (found == m_index.end() || m_entries[found->second].text != line)
+	{
+		++m_stats.misses;
+		return false;
+	}
+
+	int entry = found->second;
+	unlink(entry);
+	pushNewest(entry);
+	problems = m_entries[entry].problems;
+	++m_stats.hits;
+	return true;
+}
+
+void LineCheckCache::insert(std::string_view line, const std::vector<SpellCheck::Position> &problems)
+{
+	uint64_t hash = ContentHash::of(line);
+	auto found = m_index.find(hash);
+	int entry;
+	if (found != m_index.end())
+	{
+		entry = found->second;
+		unlink(entry);
+	}
+	else if (m_entries.size() < m_capacity)
+	{
+		entry = m_entries.size();
+		m_entries.emplace_back();
+		m_index[hash] = entry;
+	}
+	else
+	{
+		// full: the least recently used line makes room
+		entry = m_oldest;
+		unlink(entry);
+		m_index.erase(m_entries[entry].hash);
+		m_index[hash] = entry;
+		++m_stats.evictions;
+	}
+
+	m_entries[entry].hash = hash;
+	m_entries[entry].text.assign(line.data(), line.size());
+	m_entries[entry].problems = problems;
+	pushNewest(entry);
+}
+
+void LineCheckCache::clear()
+{
+	m_entries.clear();
+	m_index.clear();
+	m_newest = NONE;
+	m_oldest = NONE;
+}
+
+void LineCheckCache::unlink(int entry)
+{
+	Entry &e = m_entries[entry];
+	if (e.newer != NONE)
+	{
+		m_entries[e.newer].older = e.older;
+	}
+	else
+	{
+		m_newest = e.older;
+	}
+	if (e.older != NONE)
+	{
+		m_entries[e.older].newer = e.newer;
+	}
+	else
+	{
+		m_oldest = e.newer;
+	}
+}
+
+void LineCheckCache::pushNewest(int entry)
+{
+	Entry &e = m_entries[entry];
+	e.newer = NONE;
+	e.older = m_newest;
+	if (m_newest != NONE)
+	{
+		m_entries[m_newest].newer = entry;
+	}
+	m_newest = entry;
+	if (m_oldest == NONE)
+	{
+		m_oldest = entry;
+	}
+}
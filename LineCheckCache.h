@@ -0,0 +1,61 @@
+#ifndef LINECHECKCACHE_H_
+#define LINECHECKCACHE_H_
+
+#include "SpellCheck.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The problems found on recently checked lines, keyed by the line's text: a 64-bit hash of it finds
+// the entry, and the text kept there confirms it, so lines that happen to hash alike only take each
+// other's place. Every redraw re-checks every visible line, but usually only one has changed since the
+// last one. Holds at most capacity lines, evicting the least recently used; not thread-safe.
+class LineCheckCache
+{
+public:
+	struct Stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+	};
+
+	explicit LineCheckCache(size_t capacity = 4096);
+
+	// Copy the cached problems for line into problems. False (and problems untouched) on a miss.
+	bool find(std::string_view line, std::vector<SpellCheck::Position> &problems);
+	void insert(std::string_view line, const std::vector<SpellCheck::Position> &problems);
+	// forget every line, e.g. because the dictionary changed; the stats carry on
+	void clear();
+
+	size_t size() const { return m_index.size(); }
+	const Stats &stats() const { return m_stats; }
+
+private:
+	static const int NONE = -1;
+
+	struct Entry
+	{
+		uint64_t hash;
+		std::string text; // of the line
+		std::vector<SpellCheck::Position> problems;
+		int newer; // neighbours in recency order
+		int older;
+	};
+
+	size_t m_capacity;
+	std::vector<Entry> m_entries; // grows to capacity, then slots are reused
+	std::unordered_map<uint64_t, int> m_index;
+	int m_newest;
+	int m_oldest;
+	Stats m_stats;
+
+	void unlink(int entry);
+	void pushNewest(int entry);
+};
+
+#endif // LINECHECKCACHE_H_
@@ -0,0 +1,74 @@
+#include "MappedFile.h"
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedFile::MappedFile()
+	: m_data(nullptr), m_size(0), m_open(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	// only regular files can be mapped
+	struct stat info;
+	if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+	{
+		::close(fd);
+		return false;
+	}
+
+	// an empty file is valid but has nothing to map
+	if (info.st_size > 0)
+	{
+		void *addr = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+		m_data = static_cast<const char *>(addr);
+		m_size = info.st_size;
+	}
+
+	// the mapping keeps its own reference to the file
+	::close(fd);
+	m_open = true;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<char *>(m_data), m_size);
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
+
+void MappedFile::swap(MappedFile &other)
+{
+	std::swap(m_data, other.m_data);
+	std::swap(m_size, other.m_size);
+	std::swap(m_open, other.m_open);
+}
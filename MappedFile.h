@@ -0,0 +1,32 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+
+// A read-only memory mapping of a whole file. The mapping stays valid until close() or destruction,
+// even if the file is renamed or unlinked on disk.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string &path);
+	void close();
+	void swap(MappedFile &other);
+
+	bool isOpen() const { return m_open; }
+	const char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const char *m_data;
+	size_t m_size;
+	bool m_open;
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+};
+
+#endif // MAPPEDFILE_H_
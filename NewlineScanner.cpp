@@ -0,0 +1,102 @@
+#include "NewlineScanner.h"
+#include "ByteClassifier.h"
+
+#ifdef BYTECLASSIFIER_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	uint64_t classifyScalar(const char *block)
+	{
+		// bit i set if block[i] is '\n'
+		uint64_t mask = 0;
+		for (int i = 0; i < 64; ++i)
+		{
+			if (block[i] == '\n')
+			{
+				mask |= 1ull << i;
+			}
+		}
+		return mask;
+	}
+
+#ifdef BYTECLASSIFIER_X86
+	__attribute__((target("sse2"))) uint64_t classifySse2(const char *block)
+	{
+		const __m128i newline = _mm_set1_epi8('\n');
+
+		uint64_t mask = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+			__m128i found = _mm_cmpeq_epi8(bytes, newline);
+			mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(found))) << (16 * i);
+		}
+		return mask;
+	}
+
+	__attribute__((target("avx2"))) uint64_t classifyAvx2(const char *block)
+	{
+		const __m256i newline = _mm256_set1_epi8('\n');
+
+		uint64_t mask = 0;
+		for (int i = 0; i < 2; ++i)
+		{
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32 * i));
+			__m256i found = _mm256_cmpeq_epi8(bytes, newline);
+			mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(found))) << (32 * i);
+		}
+		return mask;
+	}
+#endif
+
+	const ByteClassifier &classifier()
+	{
+#ifdef BYTECLASSIFIER_X86
+		static const ByteClassifier chosen(classifyScalar, classifySse2, classifyAvx2);
+#else
+		static const ByteClassifier chosen(classifyScalar, nullptr, nullptr);
+#endif
+		return chosen;
+	}
+}
+
+NewlineScanner::NewlineScanner(const char *data, size_t size, size_t from)
+	: m_data(data), m_size(size), m_block(from), m_mask(0)
+{
+	loadBlock(from);
+}
+
+const char *NewlineScanner::implementation()
+{
+	return classifier().name();
+}
+
+bool NewlineScanner::next(size_t &newline)
+{
+	// blocks without a newline cost one compare each
+	while (m_mask == 0)
+	{
+		if (m_block + BLOCK >= m_size)
+		{
+			return false;
+		}
+		loadBlock(m_block + BLOCK);
+	}
+	int bit = ByteClassifier::lowestBit(m_mask);
+	newline = m_block + bit;
+
+	// consume it
+	m_mask &= m_mask - 1;
+	return true;
+}
+
+void NewlineScanner::loadBlock(size_t block)
+{
+	// NULs past the end are never newlines
+	m_block = block;
+	m_mask = classifier().classify(m_data, m_size, block);
+}
@@ -0,0 +1,34 @@
+#ifndef NEWLINESCANNER_H_
+#define NEWLINESCANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Finds the '\n' bytes in a buffer, for splitting it into lines. Like WordScanner, bytes are
+// compared 64 at a time into a bitmask (AVX2 or SSE2 when the CPU has them, a plain loop otherwise)
+// and newlines are read off the mask with bit scans, so short lines cost a few instructions each
+// instead of a memchr call apiece.
+class NewlineScanner
+{
+public:
+	// scan data[from, size)
+	NewlineScanner(const char *data, size_t size, size_t from = 0);
+
+	// Find the next '\n' and return its offset from data.
+	bool next(size_t &newline);
+
+	// Name of the classifier in use: "avx2", "sse2" or "scalar".
+	static const char *implementation();
+
+private:
+	static const size_t BLOCK = 64;
+
+	const char *m_data;
+	size_t m_size;
+	size_t m_block; // offset of the block m_mask describes
+	uint64_t m_mask; // newline bits of that block, cleared below the scan position
+
+	void loadBlock(size_t block);
+};
+
+#endif // NEWLINESCANNER_H_
@@ -2,6 +2,7 @@
 #define SPELLCHECK_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 class SpellCheck {
@@ -11,6 +12,27 @@ public:
 		int end; // inclusive
 	};
 
+	// Suggestions stored back to back in one caller-owned buffer. A buffer reused across calls stops
+	// allocating once it has grown to fit the largest answer.
+	class SuggestionBuffer {
+	public:
+		void clear() { m_text.clear(); m_ends.clear(); }
+		bool empty() const { return m_ends.empty(); }
+		int size() const { return m_ends.size(); }
+		void push_back(std::string_view word) {
+			m_text.append(word.data(), word.size());
+			m_ends.push_back(m_text.size());
+		}
+		std::string_view operator[](int i) const {
+			size_t start = i == 0 ? 0 : m_ends[i - 1];
+			return std::string_view(m_text).substr(start, m_ends[i] - start);
+		}
+
+	private:
+		std::string m_text;
+		std::vector<size_t> m_ends; // end of each word in m_text
+	};
+
 	SpellCheck() { }
 	virtual ~SpellCheck() { }
 
@@ -18,6 +40,34 @@ public:
 	virtual bool spellCheck(std::string word, int maxSuggestions, std::vector<std::string>& suggestions) = 0;
 	virtual void spellCheckLine(const std::string& line, std::vector<Position>& problems) = 0;
 
+	// Allocation-free forms of the two above: views in, caller-owned storage out. These defaults go
+	// through the string versions; checkers that can avoid the copies override them.
+	virtual bool spellCheck(std::string_view word, int maxSuggestions, SuggestionBuffer& suggestions) {
+		std::vector<std::string> found;
+		bool correct = spellCheck(std::string(word), maxSuggestions, found);
+		suggestions.clear();
+		for (const auto& s : found)
+			suggestions.push_back(s);
+		return correct;
+	}
+	virtual void spellCheckLine(std::string_view line, std::vector<Position>& problems) {
+		spellCheckLine(std::string(line), problems);
+	}
+
+	// Check a whole document at once; problems[i] gets the problems on lines[i]. Checkers that can
+	// spread the lines over threads or batch them over a connection override this.
+	virtual void spellCheckDocument(const std::vector<std::string>& lines, std::vector<std::vector<Position>>& problems) {
+		problems.resize(lines.size());
+		for (size_t i = 0; i < lines.size(); ++i)
+			spellCheckLine(lines[i], problems[i]);
+	}
+
+	// One line of counters for the user, e.g. how often a cache answered; empty if the checker keeps
+	// none.
+	virtual std::string statistics() const {
+		return "";
+	}
+
 private:
 
 };
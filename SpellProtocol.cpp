@@ -0,0 +1,325 @@
+#include "SpellProtocol.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: SO_NOSIGPIPE is set on the socket instead
+#endif
+
+namespace
+{
+	template <typename T>
+	void appendValue(std::string &out, T value)
+	{
+		out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+
+	template <typename T>
+	bool readValue(std::string_view &in, T &value)
+	{
+		// consume sizeof(T) bytes from the front of in
+		if (in.size() < sizeof(value))
+		{
+			return false;
+		}
+		memcpy(&value, in.data(), sizeof(value));
+		in.remove_prefix(sizeof(value));
+		return true;
+	}
+}
+
+std::string spellSocketDir()
+{
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+	if (runtime != nullptr && *runtime != '\0')
+	{
+		return runtime;
+	}
+	return "/tmp/wurdd-" + to_string(getuid());
+}
+
+std::string defaultSpellSocketPath()
+{
+	const char *env = getenv("WURDD_SOCKET");
+	if (env != nullptr && *env != '\0')
+	{
+		return env;
+	}
+	return spellSocketDir() + "/wurdd.sock";
+}
+
+bool makePrivateDir(const std::string &dir)
+{
+	// lstat, so a link someone else planted there isn't followed
+	struct stat info;
+	if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+	{
+		return false;
+	}
+	return lstat(dir.c_str(), &info) == 0 && S_ISDIR(info.st_mode) && info.st_uid == getuid() && (info.st_mode & 077) == 0;
+}
+
+bool peerIsThisUser(int fd)
+{
+#ifdef SO_PEERCRED
+	ucred credentials;
+	socklen_t size = sizeof(credentials);
+	return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0 && credentials.uid == getuid();
+#else
+	uid_t uid;
+	gid_t gid;
+	return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+void appendSpellRequest(std::string &out, uint32_t id, SpellOp op, uint16_t maxSuggestions, std::string_view payload)
+{
+	SpellRequestHeader header = {static_cast<uint32_t>(payload.size()), id, static_cast<uint8_t>(op), 0, maxSuggestions};
+	appendValue(out, header);
+	out.append(payload.data(), payload.size());
+}
+
+size_t beginSpellResponse(std::string &out, uint32_t id, SpellStatus status)
+{
+	size_t start = out.size();
+	SpellResponseHeader header = {0, id, static_cast<uint8_t>(status), {0, 0, 0}};
+	appendValue(out, header);
+	return start;
+}
+
+void endSpellResponse(std::string &out, size_t start)
+{
+	// length is the first field of the header
+	uint32_t length = out.size() - start - sizeof(SpellResponseHeader);
+	memcpy(&out[start], &length, sizeof(length));
+}
+
+void encodeHello(std::string &out, uint64_t dictSize, int64_t dictMtime, const std::string &dictPath)
+{
+	appendValue(out, dictSize);
+	appendValue(out, dictMtime);
+	out += dictPath;
+}
+
+bool decodeHello(std::string_view in, uint64_t &dictSize, int64_t &dictMtime, std::string &dictPath)
+{
+	if (!readValue(in, dictSize) || !readValue(in, dictMtime))
+	{
+		return false;
+	}
+	dictPath.assign(in.data(), in.size());
+	return true;
+}
+
+void encodePositions(std::string &out, const std::vector<SpellCheck::Position> &positions)
+{
+	appendValue(out, static_cast<uint32_t>(positions.size()));
+	for (auto it = positions.begin(); it != positions.end(); ++it)
+	{
+		appendValue(out, static_cast<int32_t>(it->start));
+		appendValue(out, static_cast<int32_t>(it->end));
+	}
+}
+
+bool decodePositions(std::string_view in, std::vector<SpellCheck::Position> &positions)
+{
+	positions.clear();
+	uint32_t count;
+	if (!readValue(in, count) || in.size() != count * 2 * sizeof(int32_t))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		int32_t start, end;
+		readValue(in, start);
+		readValue(in, end);
+		positions.push_back(SpellCheck::Position{start, end});
+	}
+	return true;
+}
+
+void encodeSuggestions(std::string &out, bool correct, const SpellCheck::SuggestionBuffer &suggestions)
+{
+	appendValue(out, static_cast<uint8_t>(correct));
+	for (int i = 0; i < suggestions.size(); ++i)
+	{
+		appendValue(out, static_cast<uint16_t>(suggestions[i].size()));
+		out.append(suggestions[i].data(), suggestions[i].size());
+	}
+}
+
+bool decodeSuggestions(std::string_view in, bool &correct, SpellCheck::SuggestionBuffer &suggestions)
+{
+	suggestions.clear();
+	uint8_t flag;
+	if (!readValue(in, flag))
+	{
+		return false;
+	}
+	correct = flag != 0;
+
+	while (!in.empty())
+	{
+		uint16_t length;
+		if (!readValue(in, length) || in.size() < length)
+		{
+			return false;
+		}
+		suggestions.push_back(in.substr(0, length));
+		in.remove_prefix(length);
+	}
+	return true;
+}
+
+SpellConnection::SpellConnection()
+	: m_fd(-1), m_nextId(1), m_inPos(0)
+{
+}
+
+SpellConnection::~SpellConnection()
+{
+	close();
+}
+
+bool SpellConnection::connect(const std::string &socketPath)
+{
+	close();
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+	{
+		return false;
+	}
+	memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+	m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_fd < 0)
+	{
+		return false;
+	}
+#ifdef SO_NOSIGPIPE
+	int on = 1;
+	setsockopt(m_fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+	// a daemon that is stuck fails requests rather than holding the caller up
+	timeval timeout = {SPELL_TIMEOUT_MS / 1000, (SPELL_TIMEOUT_MS % 1000) * 1000};
+	setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(m_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	// the lines sent are the user's document, so only to a daemon of the user's own
+	if (::connect(m_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || !peerIsThisUser(m_fd))
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void SpellConnection::close()
+{
+	if (m_fd >= 0)
+	{
+		::close(m_fd);
+	}
+	m_fd = -1;
+	m_out.clear();
+	m_in.clear();
+	m_inPos = 0;
+}
+
+uint32_t SpellConnection::send(SpellOp op, std::string_view payload, uint16_t maxSuggestions)
+{
+	uint32_t id = m_nextId++;
+	appendSpellRequest(m_out, id, op, maxSuggestions, payload);
+	return id;
+}
+
+bool SpellConnection::flush()
+{
+	// one write for everything queued since the last flush
+	size_t written = 0;
+	while (written < m_out.size())
+	{
+		ssize_t n = ::send(m_fd, m_out.data() + written, m_out.size() - written, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			close();
+			return false;
+		}
+		written += n;
+	}
+
+	m_out.clear();
+	return true;
+}
+
+bool SpellConnection::receive(SpellResponseHeader &header, std::string &payload)
+{
+	if (!fill(sizeof(header)))
+	{
+		return false;
+	}
+	memcpy(&header, m_in.data() + m_inPos, sizeof(header));
+	if (header.length > SPELL_MAX_PAYLOAD || !fill(sizeof(header) + header.length))
+	{
+		close();
+		return false;
+	}
+
+	payload.assign(m_in, m_inPos + sizeof(header), header.length);
+	m_inPos += sizeof(header) + header.length;
+	return true;
+}
+
+bool SpellConnection::fill(size_t needed)
+{
+	// make sure at least needed unconsumed bytes are buffered, reading as much as is available
+	if (m_in.size() - m_inPos >= needed)
+	{
+		return true;
+	}
+	if (m_fd < 0)
+	{
+		return false;
+	}
+
+	// drop consumed bytes before reading more
+	m_in.erase(0, m_inPos);
+	m_inPos = 0;
+
+	char chunk[65536];
+	while (m_in.size() - m_inPos < needed)
+	{
+		ssize_t n = ::recv(m_fd, chunk, sizeof(chunk), 0);
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			close();
+			return false;
+		}
+		m_in.append(chunk, n);
+	}
+	return true;
+}
@@ -0,0 +1,107 @@
+#ifndef SPELLPROTOCOL_H_
+#define SPELLPROTOCOL_H_
+
+// The binary protocol spoken between wurdd and its clients over a Unix domain socket. Every message is
+// a fixed 12-byte header followed by `length` payload bytes, in host byte order since both ends share
+// a machine. Clients may pipeline any number of requests on a connection; responses come back in
+// request order, each tagged with its request's id.
+//
+//   HELLO       no payload         -> u64 dictionary size, i64 dictionary mtime, dictionary path
+//   CHECK_LINE  line               -> u32 count, then count x (i32 start, i32 end)
+//   SUGGEST     word               -> u8 correct, then per suggestion (u16 length, bytes)
+
+#include "SpellCheck.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SpellRequestHeader
+{
+	uint32_t length;
+	uint32_t id;
+	uint8_t op;
+	uint8_t reserved;
+	uint16_t maxSuggestions;
+};
+
+struct SpellResponseHeader
+{
+	uint32_t length;
+	uint32_t id;
+	uint8_t status;
+	uint8_t reserved[3];
+};
+
+enum SpellOp
+{
+	SPELL_HELLO = 1,
+	SPELL_CHECK_LINE = 2,
+	SPELL_SUGGEST = 3
+};
+
+enum SpellStatus
+{
+	SPELL_OK = 0,
+	SPELL_BAD_REQUEST = 1
+};
+
+const uint32_t SPELL_MAX_PAYLOAD = 1 << 24;
+// a client gives up on a daemon that takes longer than this to take a request or answer it
+const int SPELL_TIMEOUT_MS = 1000;
+
+// Where the default socket goes: a directory no other user can get into, $XDG_RUNTIME_DIR if set,
+// otherwise /tmp/wurdd-UID, which wurdd makes
+std::string spellSocketDir();
+// $WURDD_SOCKET if set, otherwise wurdd.sock in spellSocketDir()
+std::string defaultSpellSocketPath();
+// Make dir, readable only by this user, unless it exists; false if it exists but isn't a directory
+// of this user's that no one else can get into.
+bool makePrivateDir(const std::string &dir);
+// Whether the process at the other end of a connected Unix socket runs as this user.
+bool peerIsThisUser(int fd);
+
+void appendSpellRequest(std::string &out, uint32_t id, SpellOp op, uint16_t maxSuggestions, std::string_view payload);
+
+// Responses are built in place: begin writes the header, the payload is appended, end fixes the length.
+size_t beginSpellResponse(std::string &out, uint32_t id, SpellStatus status);
+void endSpellResponse(std::string &out, size_t start);
+
+void encodeHello(std::string &out, uint64_t dictSize, int64_t dictMtime, const std::string &dictPath);
+bool decodeHello(std::string_view in, uint64_t &dictSize, int64_t &dictMtime, std::string &dictPath);
+void encodePositions(std::string &out, const std::vector<SpellCheck::Position> &positions);
+bool decodePositions(std::string_view in, std::vector<SpellCheck::Position> &positions);
+void encodeSuggestions(std::string &out, bool correct, const SpellCheck::SuggestionBuffer &suggestions);
+bool decodeSuggestions(std::string_view in, bool &correct, SpellCheck::SuggestionBuffer &suggestions);
+
+// A blocking client connection. Requests are queued by send() and written by flush(), so any number
+// can be pipelined before reading the responses back with receive(). It only connects to a daemon
+// running as this user, and a write or read that waits SPELL_TIMEOUT_MS fails, closing it.
+class SpellConnection
+{
+public:
+	SpellConnection();
+	~SpellConnection();
+
+	bool connect(const std::string &socketPath);
+	void close();
+	bool isOpen() const { return m_fd >= 0; }
+
+	uint32_t send(SpellOp op, std::string_view payload, uint16_t maxSuggestions = 0);
+	bool flush();
+	bool receive(SpellResponseHeader &header, std::string &payload);
+
+private:
+	int m_fd;
+	uint32_t m_nextId;
+	std::string m_out;
+	std::string m_in;
+	size_t m_inPos;
+
+	bool fill(size_t needed);
+
+	SpellConnection(const SpellConnection &) = delete;
+	SpellConnection &operator=(const SpellConnection &) = delete;
+};
+
+#endif // SPELLPROTOCOL_H_
@@ -1,66 +1,81 @@
 #include "StudentSpellCheck.h"
+#include "DictImage.h"
+#include "WordScanner.h"
 #include <string>
 #include <vector>
 #include <cctype>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 using namespace std;
 
-SpellCheck *createSpellCheck()
-{
-	return new StudentSpellCheck;
-}
-
 StudentSpellCheck::StudentSpellCheck()
 {
-	m_root = new Node;
-	m_root->value = 0; // dummy value provided that will never be checked
 }
 
 StudentSpellCheck::~StudentSpellCheck()
 {
-	destroyTrie(m_root);
 }
 
 bool StudentSpellCheck::load(std::string dictionaryFile)
 {
-	// O(N): looping trough line and adding to trie is constant time
-	ifstream infile(dictionaryFile);
+	// a compiled image is mapped and queried in place, no parsing needed
+	if (mapDictImage(dictionaryFile, nullptr, m_image, m_trie))
+	{
+		return true;
+	}
 
 	// dict could not be processed
-	if (!infile)
+	DictStamp stamp;
+	if (!statDictSource(dictionaryFile, stamp))
 	{
 		return false;
 	}
 
-	string line;
-	while (getline(infile, line))
+	// reuse the image cached next to a plain-text dictionary unless the text changed since
+	string cachePath = dictCachePath(dictionaryFile);
+	if (mapDictImage(cachePath, &stamp, m_image, m_trie))
 	{
-		// strip nonalpha non apostrophe chars
-		string processedLine;
-		for (int i = 0; i < line.size(); ++i)
-		{
-			if (isalpha(line[i]) || line[i] == '\'')
-			{
-				processedLine += toupper(line[i]);
-			}
-		}
+		return true;
+	}
 
-		// add to trie, if there's something to add
-		if (!processedLine.empty())
-		{
-			insert(processedLine);
-		}
+	// O(N log N): collect every word, then lay the trie out in one pass over the sorted list
+	vector<string> words;
+	if (!readWordList(dictionaryFile, words))
+	{
+		return false;
 	}
 
-	// trie created, so return true
+	// replaces any previously loaded dictionary
+	m_trie.build(words);
+	m_image.close();
+
+	// caching is best effort (the directory may be read-only)
+	writeDictImage(cachePath, m_trie, stamp);
 	return true;
 }
 
 bool StudentSpellCheck::spellCheck(std::string word, int max_suggestions, std::vector<std::string> &suggestions)
 {
-	// O(L^2 + oldS)
+	SuggestionBuffer found;
+	bool correct = spellCheck(string_view(word), max_suggestions, found);
+	suggestions.clear();
+	for (int i = 0; i < found.size(); ++i)
+	{
+		suggestions.emplace_back(found[i]);
+	}
+	return correct;
+}
+
+void StudentSpellCheck::spellCheckLine(const std::string &line, std::vector<SpellCheck::Position> &problems)
+{
+	spellCheckLine(string_view(line), problems);
+}
+
+bool StudentSpellCheck::spellCheck(std::string_view word, int max_suggestions, SuggestionBuffer &suggestions)
+{
+	// O(L) for a correct word; see searchTrie() for the cost of finding suggestions
 	// check if word already in dict
 	if (findWord(word))
 	{
@@ -68,213 +83,254 @@ bool StudentSpellCheck::spellCheck(std::string word, int max_suggestions, std::v
 	}
 
 	suggestions.clear();
-	int numFound = 0;
-	// check all possible 1-off word combinations
-	// as long as we still want to find suggestions
-	for (int ch = 0; ch < word.size() && numFound != max_suggestions; ++ch)
+	if (word.empty() || max_suggestions <= 0)
 	{
-		string wordCopy = word;
-		for (int letter = 0; letter < ALPHABET.size(); ++letter)
-		{
-			// determine capitalization of char replacement
-			if (isupper(wordCopy[ch]))
-			{
-				wordCopy[ch] = toupper(ALPHABET[letter]);
-			}
-			else
-			{
-				wordCopy[ch] = tolower(ALPHABET[letter]);
-			}
-			// if modified word in trie, add to suggestions
-			if (findWord(wordCopy))
-			{
-				suggestions.push_back(wordCopy);
-				++numFound;
-			}
-			// if we found enough suggestions, exit
-			if (numFound == max_suggestions)
-			{
-				break;
-			}
-		}
+		return false;
 	}
 
-	// misspelled word, so ret false
-	return false;
-}
-
-void StudentSpellCheck::spellCheckLine(const std::string &line, std::vector<SpellCheck::Position> &problems)
-{
-	problems.clear();
-
-	// get vector of all word positions
-	vector<SpellCheck::Position> wordPoses = splitLine(line);
+	// scratch space for the walk, kept per thread (wurdd checks from several) so a warmed-up
+	// search doesn't allocate
+	static thread_local SuggestSearch search;
+	search.target.clear();
+	for (int i = 0; i < word.size(); ++i)
+	{
+		search.target.push_back(FlatTrie::letterIndex(word[i]));
+	}
+	search.path.clear();
 
-	// check if each word is in trie
-	for (auto it = wordPoses.begin(); it != wordPoses.end(); ++it)
+	// deepest row needed: a word longer than L + MAX_EDIT_DISTANCE is always too far away
+	int width = word.size() + 1;
+	search.rows.resize((word.size() + MAX_EDIT_DISTANCE + 2) * width);
+	for (int j = 0; j < width; ++j)
 	{
-		int length = it->end - it->start + 1;
-		std::string word = line.substr(it->start, length);
-		// if word not in trie, add to problems
-		if (!findWord(word))
-		{
-			problems.push_back(*it);
-		}
+		search.rows[j] = j;
 	}
-}
+	search.maxSuggestions = max_suggestions;
+	search.bestCount = 0;
 
-void StudentSpellCheck::insert(std::string word)
-{
-	// O(L), L = length of word
-	Node *p = m_root;
+	// match the case of the misspelled word: ALL CAPS, Capitalized or lower
+	search.allUpper = word.size() > 1;
 	for (int i = 0; i < word.size(); ++i)
 	{
-		bool matchFound = false;
-		char letter = toupper(word[i]);
-		// check if current char in node's children
-		for (auto it = p->children.begin(); it != p->children.end(); ++it)
+		if (islower(static_cast<unsigned char>(word[i])))
 		{
-			// if matching child node found, proceed to that node
-			if (letter == (*it)->value)
-			{
-				p = *it;
-				matchFound = true;
-				break;
-			}
-		}
-
-		// if matching child node not found, add it
-		if (!matchFound)
-		{
-			Node *newCharNode = new Node;
-			newCharNode->value = letter;
-			p->children.push_back(newCharNode);
-			p = newCharNode;
+			search.allUpper = false;
 		}
 	}
+	search.capitalized = isupper(static_cast<unsigned char>(word[0]));
 
-	// check if word end has marker
-	bool markerExists = false;
-	for (auto it = p->children.begin(); it != p->children.end(); ++it)
+	// walk the trie once per distance, closest words first; a wider (much costlier) walk is only
+	// worth it when nothing closer was found
+	for (search.distance = 1; search.distance <= MAX_EDIT_DISTANCE && search.bestCount == 0; ++search.distance)
 	{
-		if ((*it)->value == MARKER)
-		{
-			markerExists = true;
-		}
+		search.foundCount = 0;
+		searchTrie(m_trie.root(), 0, search);
 	}
 
-	// add marker to signify end of word if necessary
-	if (!markerExists)
+	// most frequent first
+	sort_heap(search.best.begin(), search.best.begin() + search.bestCount, rankedBefore);
+	for (int i = 0; i < search.bestCount; ++i)
 	{
-		Node *marker = new Node;
-		marker->value = MARKER;
-		p->children.push_back(marker);
+		suggestions.push_back(search.best[i].word);
 	}
+
+	// misspelled word, so ret false
+	return false;
+}
+
+void StudentSpellCheck::spellCheckLine(std::string_view line, std::vector<SpellCheck::Position> &problems)
+{
+	checkLine(line, problems);
 }
 
-void StudentSpellCheck::destroyTrie(Node *root)
+void StudentSpellCheck::spellCheckDocument(const std::vector<std::string> &lines, std::vector<std::vector<SpellCheck::Position>> &problems)
 {
-	// should never happen but just a check
-	if (root == nullptr)
+	problems.resize(lines.size());
+	if (lines.size() < PARALLEL_LINES)
 	{
+		for (size_t i = 0; i < lines.size(); ++i)
+		{
+			checkLine(lines[i], problems[i]);
+		}
 		return;
 	}
 
-	// destroy all children, then destroy root
-	for (int i = 0; i < root->children.size(); ++i)
+	// the trie is only read, so chunks of lines can be checked on every core at once; each chunk
+	// fills in its own entries of problems
+	if (!m_pool)
 	{
-		destroyTrie(root->children[i]);
+		m_pool.reset(new ThreadPool);
 	}
-
-	delete root;
+	m_pool->parallelFor(lines.size(), DOCUMENT_CHUNK, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+		{
+			checkLine(lines[i], problems[i]);
+		}
+	});
 }
 
-bool StudentSpellCheck::findWord(std::string word)
+bool StudentSpellCheck::findWord(std::string_view word) const
 {
 	// O(L)
-	Node *p = m_root;
+	return m_trie.contains(word);
+}
 
-	// loop through each char in word
-	for (int i = 0; i < word.size(); ++i)
-	{
-		// loop through child nodes
-		bool charFound = false;
-		char letter = toupper(word[i]);
-		for (auto it = p->children.begin(); it != p->children.end(); ++it)
-		{
-			// check if char in a child node
-			if ((*it)->value == letter)
-			{
-				p = *it;
-				charFound = true;
-				break;
-			}
-		}
+void StudentSpellCheck::checkLine(std::string_view line, std::vector<SpellCheck::Position> &problems) const
+{
+	problems.clear();
 
-		// if char not in a child node, then word not in trie
-		if (!charFound)
+	// look each word up in place; nothing is copied out of the line
+	WordScanner words(line.data(), line.size());
+	Position word;
+	while (words.next(word.start, word.end))
+	{
+		if (!findWord(line.substr(word.start, word.end - word.start + 1)))
 		{
-			return false;
+			problems.push_back(word);
 		}
 	}
+}
 
-	// ensure last char has a marker
-	for (auto it = p->children.begin(); it != p->children.end(); ++it)
+void StudentSpellCheck::searchTrie(int node, int depth, SuggestSearch &search) const
+{
+	// O(visited nodes * distance): each child gets the next edit-distance row, and a branch is
+	// abandoned as soon as no extension of it can come within search.distance of the target.
+	// Only the band of the row within search.distance of the diagonal can be that close, so the
+	// cells just outside it are marked too far and the rest are never computed.
+	const int tooFar = search.distance + 1;
+	int length = search.target.size();
+	int width = length + 1;
+	int row = depth + 1;
+	const int *prev = &search.rows[depth * width];
+	const int *prev2 = depth > 0 ? prev - width : nullptr;
+	int *cur = &search.rows[row * width];
+	int prevLetter = depth > 0 ? FlatTrie::letterIndex(search.path[depth - 1]) : -1;
+	int lo = max(1, row - search.distance);
+	int hi = min(length, row + search.distance);
+
+	// once the whole row has used up the edit budget, the only way on is to match the target exactly
+	// (or finish a transposition), so only those letters are worth trying
+	uint32_t letters = m_trie.letters(node);
+	int nodeLo = max(0, depth - search.distance);
+	int nodeHi = min(length, depth + search.distance);
+	int nodeMin = tooFar;
+	for (int j = nodeLo; j <= nodeHi; ++j)
 	{
-		if ((*it)->value == MARKER)
+		nodeMin = min(nodeMin, prev[j]);
+	}
+	if (nodeMin >= search.distance)
+	{
+		uint32_t allowed = 0;
+		for (int j = nodeLo; j <= nodeHi; ++j)
 		{
-			return true;
+			if (j < length && prev[j] == search.distance && search.target[j] >= 0)
+			{
+				allowed |= 1u << search.target[j];
+			}
+			if (j > 0 && j < length && prev2 != nullptr && prevLetter == search.target[j] &&
+				prev2[j - 1] < search.distance && search.target[j - 1] >= 0)
+			{
+				allowed |= 1u << search.target[j - 1];
+			}
 		}
+		letters &= allowed;
 	}
 
-	// if no marker, that means the word is not in trie
-	return false;
-}
-
-std::vector<SpellCheck::Position> StudentSpellCheck::splitLine(const std::string &line)
-{
-	vector<Position> words;
-	int invalidPos = -1;
-	int start = invalidPos;
-
-	// loop over line
-	for (int i = 0; i < line.size(); ++i)
+	for (; letters != 0; letters &= letters - 1)
 	{
-		bool inAlphabet = isalpha(line[i]) || line[i] == '\'';
+		int letter = FlatTrie::lowestLetter(letters);
 
-		// if not in alpha or apostrophe, add to word vec
-		if (!inAlphabet)
+		// cost of turning the target's first j chars into the path plus this letter
+		cur[0] = row;
+		cur[lo - 1] = lo > 1 ? tooFar : row;
+		if (hi < length)
 		{
-			// only make word pos if valid alpha chars before
-			if (start != invalidPos)
-			{
-				int end = i - 1;
-				Position newPos;
-				newPos.start = start;
-				newPos.end = end;
-				words.push_back(newPos);
-				start = invalidPos;
-			}
+			cur[hi + 1] = tooFar;
 		}
-		else
+		int rowMin = cur[0];
+		int bound = tooFar;
+		for (int j = lo; j <= hi; ++j)
 		{
-			// if alpha/apostrophe char and no alpha chars since last word, set start
-			if (start == invalidPos)
+			int substitute = prev[j - 1] + (search.target[j - 1] == letter ? 0 : 1);
+			cur[j] = min(substitute, min(prev[j], cur[j - 1]) + 1);
+
+			if (j > 1)
 			{
-				start = i;
+				// transposition of the last two letters
+				if (prev2 != nullptr && letter == search.target[j - 2] && prevLetter == search.target[j - 1])
+				{
+					cur[j] = min(cur[j], prev2[j - 2] + 1);
+				}
+				// a transposition one level down starts from the previous row when this letter is its second half
+				if (search.target[j - 1] == letter)
+				{
+					bound = min(bound, prev[j - 2] + 1);
+				}
 			}
+			rowMin = min(rowMin, cur[j]);
+		}
+
+		int child = m_trie.child(node, letter);
+		char c = FlatTrie::letterAt(letter);
+		search.path.push_back(search.allUpper || (search.capitalized && depth == 0) ? c : tolower(c));
+		// cur[length] is only computed once the band reaches the end of the target
+		if (hi == length && m_trie.isWord(child) && cur[length] == search.distance)
+		{
+			keepSuggestion(child, search);
+		}
+
+		if (!searchDone(search) && min(rowMin, bound) <= search.distance)
+		{
+			searchTrie(child, depth + 1, search);
+		}
+		search.path.pop_back();
+
+		// enough suggestions, cut the walk off
+		if (searchDone(search))
+		{
+			return;
 		}
 	}
+}
 
-	// if last char is an alpha, then consider the last word
-	if (start != invalidPos)
+void StudentSpellCheck::keepSuggestion(int node, SuggestSearch &search) const
+{
+	// O(log maxSuggestions): a bounded heap keeps the best words so far with the worst on top, so a
+	// word is only copied out of the walk if it beats one already kept
+	int frequency = m_trie.frequency(node);
+	int order = search.foundCount++;
+	if (search.bestCount < search.maxSuggestions)
+	{
+		if (search.bestCount == search.best.size())
+		{
+			search.best.emplace_back();
+		}
+		++search.bestCount;
+	}
+	else if (frequency > search.best.front().frequency)
 	{
-		int end = line.size() - 1;
-		Position newPos;
-		newPos.start = start;
-		newPos.end = end;
-		words.push_back(newPos);
+		// later words lose ties, so only a higher frequency gets in; the worst moves to the end
+		pop_heap(search.best.begin(), search.best.begin() + search.bestCount, rankedBefore);
 	}
+	else
+	{
+		return;
+	}
+
+	Suggestion &slot = search.best[search.bestCount - 1];
+	slot.frequency = frequency;
+	slot.order = order;
+	slot.word.assign(search.path);
+	push_heap(search.best.begin(), search.best.begin() + search.bestCount, rankedBefore);
+}
 
-	return words;
+bool StudentSpellCheck::searchDone(const SuggestSearch &search) const
+{
+	// without frequencies every later word ranks below the ones kept, so a full heap is final
+	return !m_trie.hasFrequencies() && search.bestCount >= search.maxSuggestions;
+}
+
+bool StudentSpellCheck::rankedBefore(const Suggestion &a, const Suggestion &b)
+{
+	return a.frequency > b.frequency || (a.frequency == b.frequency && a.order < b.order);
 }
@@ -2,8 +2,13 @@
 #define STUDENTSPELLCHECK_H_
 
 #include "SpellCheck.h"
+#include "FlatTrie.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
 
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class StudentSpellCheck : public SpellCheck
@@ -14,23 +19,51 @@ public:
 	bool load(std::string dict_file);
 	bool spellCheck(std::string word, int maxSuggestions, std::vector<std::string> &suggestions);
 	void spellCheckLine(const std::string &line, std::vector<Position> &problems);
+	bool spellCheck(std::string_view word, int maxSuggestions, SuggestionBuffer &suggestions);
+	void spellCheckLine(std::string_view line, std::vector<Position> &problems);
+	void spellCheckDocument(const std::vector<std::string> &lines, std::vector<std::vector<Position>> &problems);
 
 private:
-	struct Node
+	FlatTrie m_trie;
+	MappedFile m_image; // backs m_trie when the dictionary came from a compiled image
+	std::unique_ptr<ThreadPool> m_pool; // started by the first document big enough to split up
+
+	static const int MAX_EDIT_DISTANCE = 2;
+
+	// documents shorter than this are checked on the calling thread; longer ones are handed out in
+	// chunks of DOCUMENT_CHUNK lines
+	static const size_t PARALLEL_LINES = 1024;
+	static const size_t DOCUMENT_CHUNK = 256;
+
+	// a word found by the walk; better suggestions have a higher frequency class, then were found first
+	struct Suggestion
 	{
-		std::vector<Node *> children;
-		char value;
+		int frequency;
+		int order;
+		std::string word;
 	};
 
-	Node *m_root;
-
-	static const char MARKER = '.';
-	inline static const std::string ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZ'"; //TODO: can i do this?
+	// state of one bounded edit-distance walk over the trie
+	struct SuggestSearch
+	{
+		std::vector<int> target; // letter index of each char of the misspelled word (-1 if not a letter)
+		std::vector<int> rows;	 // Damerau-Levenshtein row for each depth of the walk, target.size() + 1 wide
+		std::string path;		 // letters from the root to the current node, cased like the target
+		int distance;			 // only words exactly this far from the target are collected
+		int maxSuggestions;
+		bool allUpper;			 // target is ALL CAPS, so suggestions are too
+		bool capitalized;		 // target is Capitalized, so suggestions are too
+		int foundCount;			 // words found so far at this distance
+		std::vector<Suggestion> best; // heap of the best bestCount words found, worst on top; slots past
+		int bestCount;				  // bestCount are kept so their strings can be reused
+	};
 
-	void insert(std::string word);
-	void destroyTrie(Node *root);
-	bool findWord(std::string word);
-	std::vector<Position> splitLine(const std::string &line);
+	bool findWord(std::string_view word) const;
+	void checkLine(std::string_view line, std::vector<Position> &problems) const;
+	void searchTrie(int node, int depth, SuggestSearch &search) const;
+	void keepSuggestion(int node, SuggestSearch &search) const;
+	bool searchDone(const SuggestSearch &search) const;
+	static bool rankedBefore(const Suggestion &a, const Suggestion &b);
 };
 
 #endif // STUDENTSPELLCHECK_H_
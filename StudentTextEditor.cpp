@@ -1,19 +1,46 @@
 #include "StudentTextEditor.h"
+#include "AtomicFileWriter.h"
+#include "ContentHash.h"
 #include "Undo.h"
+#include <algorithm>
 #include <string>
-#include <list>
-#include <iostream>
-#include <fstream>
+#include <string_view>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
+namespace
+{
+	// the undo history is kept beside the document, in a file of this name plus the suffix
+	const char HISTORY_SUFFIX[] = ".wurd-undo";
+
+	// what the history is tagged with besides the text's hash, as the cheap check of whether the file
+	// is still as it was saved
+	bool fileStamp(const string &path, uint64_t &size, int64_t &mtime)
+	{
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+		{
+			return false;
+		}
+		size = info.st_size;
+#ifdef __APPLE__
+		mtime = info.st_mtimespec.tv_sec * 1000000000ll + info.st_mtimespec.tv_nsec;
+#else
+		mtime = info.st_mtim.tv_sec * 1000000000ll + info.st_mtim.tv_nsec;
+#endif
+		return true;
+	}
+}
+
 TextEditor *createTextEditor(Undo *un)
 {
 	return new StudentTextEditor(un);
 }
 
 StudentTextEditor::StudentTextEditor(Undo *undo)
-	: TextEditor(undo), m_lines({""}), m_editRowIter(m_lines.begin()), m_editRow(0), m_editCol(0)
+	: TextEditor(undo), m_editRow(0), m_editCol(0), m_recovered(false)
 {
 }
 
@@ -25,60 +52,88 @@ StudentTextEditor::~StudentTextEditor()
 bool StudentTextEditor::load(std::string file)
 {
 	reset();
-	ifstream infile(file);
 
-	// invalid file
-	if (!infile)
+	// O(1): the file is mapped and lines are views into it, indexed as they are reached (\r is dropped
+	// from line ends)
+	if (!m_buffer.load(file))
 	{
 		return false;
 	}
 
-	// loop through files and add line to node
-	string line;
-	while (getline(infile, line))
-	{
-		// remove \r from the line
-		if (!line.empty() && line[line.size() - 1] == '\r')
-		{
-			line.pop_back();
-		}
-
-		// add to text list
-		m_lines.push_back(line);
-	}
-
 	// reset editing position
 	m_editCol = 0;
 	m_editRow = 0;
-	m_editRowIter = m_lines.begin();
+
+	// pick up where a session that crashed left off, or start journaling afresh
+	int row, col;
+	m_recovered = m_journal.recover(file, m_buffer, row, col);
+	if (m_recovered)
+	{
+		moveTo(row, col);
+	}
+	else
+	{
+		m_journal.start(file, m_buffer);
+	}
+
+	// undo carries on from the last save, if the file is still as it was saved. Its size and time are
+	// checked here and its text, O(N), only once the history is used; the loaded text stays put until
+	// the next load or reset, which clear the history first. Edits recovered from the journal aren't
+	// in it, so it's left be then
+	string history = file + HISTORY_SUFFIX;
+	uint64_t size;
+	int64_t mtime;
+	if (!m_recovered && access(history.c_str(), F_OK) == 0 && fileStamp(file, size, mtime))
+	{
+		getUndo()->loadHistory(history, size, mtime, [this] { return ContentHash::of(m_buffer.loadedText()); });
+	}
 
 	return true;
 }
 
 bool StudentTextEditor::save(std::string file)
 {
-	ofstream outfile(file);
-
-	// check file creation success
-	if (!outfile)
+	// unedited lines are views into the loaded file, which may be this one, so it must not be
+	// truncated while they're read: the writer fills a new file and renames it over the old one
+	AtomicFileWriter outfile;
+	if (!outfile.open(file))
 	{
 		return false;
 	}
 
-	// save each line
-	for (auto it = m_lines.begin(); it != m_lines.end(); ++it)
+	// save each line; unedited ones go out in runs straight from the loaded text
+	ContentHash hash;
+	m_buffer.forEachSpan([&](string_view text) {
+		outfile.write(text);
+		hash.add(text);
+	});
+
+	if (!outfile.commit())
 	{
-		outfile << *it << endl;
+		return false;
 	}
 
+	// the file has every change now, so the journal starts over from it
+	m_journal.start(file, m_buffer);
+
+	// and the undo history goes out with it, tagged with what it was saved against; losing it loses
+	// nothing of the file's
+	uint64_t size;
+	int64_t mtime;
+	if (fileStamp(file, size, mtime))
+	{
+		getUndo()->saveHistory(file + HISTORY_SUFFIX, size, mtime, hash.value());
+	}
 	return true;
 }
 
 void StudentTextEditor::reset()
 {
-	// clear lines and reset cursor
-	m_lines.clear();
-	m_editRowIter = m_lines.begin();
+	// back to one empty line and reset cursor; the journal is dropped first, since it may still be
+	// writing out the old text
+	m_journal.stop();
+	m_recovered = false;
+	m_buffer.clear();
 	m_editRow = 0;
 	m_editCol = 0;
 
@@ -100,7 +155,7 @@ void StudentTextEditor::move(Dir dir)
 
 	case DOWN:
 		// increment editRow, unless we are already at the end
-		if (m_editRow != m_lines.size() - 1)
+		if (m_buffer.hasLine(m_editRow + 1))
 		{
 			moveCursor(m_editRow + 1, m_editCol);
 		}
@@ -115,9 +170,8 @@ void StudentTextEditor::move(Dir dir)
 		// if first col, move to end of prev line
 		else if (m_editCol == 0)
 		{
-			--m_editRowIter;
 			--m_editRow;
-			m_editCol = m_editRowIter->size(); // space after last char on that line
+			m_editCol = m_buffer.lineLength(m_editRow); // space after last char on that line
 			break;
 		}
 
@@ -130,14 +184,13 @@ void StudentTextEditor::move(Dir dir)
 
 	case RIGHT:
 		// if we at the last row, last col, then do nothing
-		if (m_editCol == m_editRowIter->size() && m_editRow == m_lines.size() - 1)
+		if (m_editCol == m_buffer.lineLength(m_editRow) && !m_buffer.hasLine(m_editRow + 1))
 		{
 			break;
 		}
 		// if at end of a line, move to next line
-		else if (m_editCol == m_editRowIter->size())
+		else if (m_editCol == m_buffer.lineLength(m_editRow))
 		{
-			++m_editRowIter;
 			++m_editRow;
 			m_editCol = 0;
 			break;
@@ -155,15 +208,24 @@ void StudentTextEditor::move(Dir dir)
 		break;
 
 	case END:
-		// cursor at last row, last col
-		m_editRowIter = m_lines.end();
-		--m_editRowIter;
-		m_editRow = m_lines.size() - 1;
-		m_editCol = m_editRowIter->size(); // space after last char
+		// cursor at last row, last col; indexes the whole document
+		m_editRow = m_buffer.lineCount() - 1;
+		m_editCol = m_buffer.lineLength(m_editRow); // space after last char
 		break;
 	}
 }
 
+void StudentTextEditor::moveTo(int row, int col)
+{
+	// O(log N) to any row, O(1) near the last one looked up; past the end is the last row
+	row = max(0, row);
+	if (!m_buffer.hasLine(row))
+	{
+		row = m_buffer.lineCount() - 1;
+	}
+	moveCursor(row, max(0, col));
+}
+
 void StudentTextEditor::del()
 {
 	// always inform undo
@@ -197,28 +259,21 @@ void StudentTextEditor::getPos(int &row, int &col) const
 int StudentTextEditor::getLines(int startRow, int numRows, std::vector<std::string> &lines) const
 {
 	// boundary conditions
-	if (startRow < 0 || numRows < 0 || startRow > m_lines.size())
+	if (startRow < 0 || numRows < 0 || (startRow > 0 && !m_buffer.hasLine(startRow - 1)))
 	{
 		return -1;
 	}
 	lines.clear();
 
-	// if startRow equal to size, nothing to be added to lines
-	if (startRow == m_lines.size())
-	{
-		return 0;
-	}
-
-	// create copy of iterator to iterate through desired lines
-	int endRow = (m_lines.size() < (startRow + numRows)) ? m_lines.size() : (startRow + numRows);
-	auto rowCopy = m_editRowIter;
-	std::advance(rowCopy, startRow - m_editRow); // get to startRow 
-
-	// add to lines
-	for (int i = startRow; i < endRow; ++i, ++rowCopy)
+	// O(log N) to find startRow, then O(1) per line; only indexes as far as endRow
+	int endRow = startRow + numRows;
+	if (numRows > 0 && !m_buffer.hasLine(endRow - 1))
 	{
-		lines.push_back(*rowCopy);
+		endRow = m_buffer.lineCount();
 	}
+	m_buffer.forEachLine(startRow, endRow, [&](string_view line) {
+		lines.emplace_back(line);
+	});
 
 	// return num lines copied
 	return endRow - startRow;
@@ -230,67 +285,221 @@ void StudentTextEditor::undo()
 	int row, col, count;
 	string text;
 
-	Undo::Action action = getUndo()->get(row, col, count, text);
+	// the actions of a group, e.g. from applyEdits(), are undone together
+	do
+	{
+		Undo::Action action = getUndo()->get(row, col, count, text);
+		replay(action, row, col, count, text);
+		if (action == Undo::Action::SPLIT)
+		{
+			moveCursor(row, col); // enter moves cursor down to next line
+		}
+	} while (getUndo()->moreInGroup());
+}
+
+void StudentTextEditor::redo()
+{
+	int row, col, count;
+	string text;
+
+	// the changes undo() took back, made again in the order they were first made; the cursor ends up
+	// where each left it
+	do
+	{
+		Undo::Action action = getUndo()->redo(row, col, count, text);
+		replay(action, row, col, count, text);
+		if (action == Undo::Action::INSERT)
+		{
+			// after the text, which may run over several lines
+			size_t lastBreak = text.rfind('\n');
+			if (lastBreak == string::npos)
+			{
+				moveCursor(row, col + count);
+			}
+			else
+			{
+				moveCursor(row + std::count(text.begin(), text.end(), '\n'), text.size() - lastBreak - 1);
+			}
+		}
+	} while (getUndo()->moreInGroup());
+}
+
+bool StudentTextEditor::applyEdits(const std::vector<Edit> &edits)
+{
+	// check them all before changing anything
+	for (size_t i = 0; i < edits.size(); ++i)
+	{
+		const Edit &edit = edits[i];
+		if (edit.row < 0 || edit.col < 0 || edit.count < 0 || !m_buffer.hasLine(edit.row) ||
+			edit.col + edit.count > m_buffer.lineLength(edit.row) || edit.text.find('\n') != string::npos)
+		{
+			return false;
+		}
+		const Edit *prev = i > 0 ? &edits[i - 1] : nullptr;
+		if (prev && (edit.row < prev->row || (edit.row == prev->row && edit.col < prev->col + prev->count)))
+		{
+			return false;
+		}
+	}
+
+	// O(edits log N + chars changed), last first, so the positions of the ones still to come don't
+	// move; that also leaves each edit's undo actions relative to the text as it stood after it, which
+	// is the order undo meets them in
+	getUndo()->beginGroup();
+	for (size_t i = edits.size(); i-- > 0;)
+	{
+		const Edit &edit = edits[i];
+		if (edit.count > 0)
+		{
+			getUndo()->submitText(Undo::Action::DELETE, edit.row, edit.col, m_buffer.substr(edit.row, edit.col, edit.count));
+			m_buffer.erase(edit.row, edit.col, edit.count);
+			m_journal.erase(edit.row, edit.col, edit.count);
+		}
+		if (!edit.text.empty())
+		{
+			m_buffer.insert(edit.row, edit.col, edit.text);
+			m_journal.insert(edit.row, edit.col, edit.text);
+			getUndo()->submitText(Undo::Action::INSERT, edit.row, edit.col, edit.text);
+		}
+	}
+	getUndo()->endGroup();
+
+	// same row and col as before, still within the line
+	moveCursor(m_editRow, m_editCol);
+	return true;
+}
+
+bool StudentTextEditor::find(const TextSearch &search, int &length)
+{
+	// from just after the cursor to the end, then from the top round to the cursor; lines are searched
+	// where they are, and the document is only indexed as far as the match
+	size_t start, found;
+	int row = m_buffer.findLine(m_editRow, -1, [&](int row, string_view line) {
+		return search.find(line, row == m_editRow ? m_editCol + 1 : 0, start, found);
+	});
+	if (row < 0)
+	{
+		row = m_buffer.findLine(0, m_editRow + 1, [&](int row, string_view line) {
+			return search.find(line, 0, start, found) && (row < m_editRow || static_cast<int>(start) <= m_editCol);
+		});
+	}
+	if (row < 0)
+	{
+		return false;
+	}
+	moveCursor(row, start);
+	length = found;
+	return true;
+}
 
-	// apply undo action based on action type
+int StudentTextEditor::replaceAll(const TextSearch &search, const std::string &replacement)
+{
+	// O(N) to find them all, then one pass to replace them
+	vector<Edit> edits;
+	m_buffer.findLine(0, -1, [&](int row, string_view line) {
+		size_t start, length;
+		for (size_t from = 0; search.find(line, from, start, length); from = start + length)
+		{
+			edits.push_back(Edit{row, static_cast<int>(start), static_cast<int>(length), replacement});
+		}
+		return false;
+	});
+	return !edits.empty() && applyEdits(edits) ? edits.size() : 0;
+}
+
+bool StudentTextEditor::recovered() const
+{
+	return m_recovered;
+}
+
+void StudentTextEditor::moveCursor(int row, int col)
+{
+	// O(log N)
+	m_editRow = row;
+	m_editCol = min(col, m_buffer.lineLength(row));
+}
+
+void StudentTextEditor::replay(Undo::Action action, int row, int col, int count, const std::string &text)
+{
+	// apply action based on action type, without adding it to the undo stack
 	switch (action)
 	{
 	case Undo::Action::INSERT:
+	{
+		// insert the text a line at a time, each in one go; cursor stays at its start
 		moveCursor(row, col);
-		for (int i = 0; i < text.size(); ++i)
+		row = m_editRow;
+		col = m_editCol;
+		size_t start = 0;
+		for (size_t end; (end = text.find('\n', start)) != string::npos; start = end + 1)
+		{
+			string_view piece(text.data() + start, end - start);
+			m_buffer.insert(row, col, piece);
+			m_journal.insert(row, col, piece);
+			m_buffer.split(row, col + piece.size());
+			m_journal.split(row, col + piece.size());
+			++row;
+			col = 0;
+		}
+		if (start < text.size())
 		{
-			// don't add this insert to undo stack
-			undoableInsert(text[i], false);
+			string_view rest(text.data() + start, text.size() - start);
+			m_buffer.insert(row, col, rest);
+			m_journal.insert(row, col, rest);
 		}
-		moveCursor(row, col); // move cursor back after insertions
 		break;
+	}
 	case Undo::Action::DELETE:
+		// count chars from the cursor on, each line end among them joining the next line on
 		moveCursor(row, col);
-		for (int i = 0; i < count; ++i)
+		while (count > 0)
 		{
-			// don't add this delete to undo stack
-			undoableDel(false);
+			int n = min(count, m_buffer.lineLength(m_editRow) - m_editCol);
+			if (n > 0)
+			{
+				m_buffer.erase(m_editRow, m_editCol, n);
+				m_journal.erase(m_editRow, m_editCol, n);
+				count -= n;
+			}
+			if (count > 0)
+			{
+				if (!m_buffer.hasLine(m_editRow + 1))
+				{
+					break;
+				}
+				m_buffer.join(m_editRow);
+				m_journal.join(m_editRow);
+				--count;
+			}
 		}
 		break;
 	case Undo::Action::SPLIT:
 		moveCursor(row, col);
-		// don't add this enter to undo stack
 		undoableEnter(false);
-		moveCursor(row, col); // enter moves cursor down to next line
 		break;
 	case Undo::Action::JOIN:
 		moveCursor(row, col);
-		// don't add this del to undo stack
 		undoableDel(false);
-
+		break;
 	case Undo::Action::ERROR:
 		break;
 	}
 }
 
-void StudentTextEditor::moveCursor(int row, int col)
-{
-	std::advance(m_editRowIter, row - m_editRow);
-	m_editRow = row;
-	int numCols = m_editRowIter->size();
-	m_editCol = min(col, numCols);
-}
-
 void StudentTextEditor::undoableDel(bool isUndoable)
 {
+	int length = m_buffer.lineLength(m_editRow);
+
 	// can't delete at EOF
-	if (m_editRow == m_lines.size() - 1 && m_editCol == m_editRowIter->size())
+	if (m_editCol == length && !m_buffer.hasLine(m_editRow + 1))
 	{
 		return;
 	}
 	// if at end of line, merge with next line
-	else if (m_editCol == m_editRowIter->size())
+	else if (m_editCol == length)
 	{
-
-		auto nextLine = ++m_editRowIter;
-		--m_editRowIter;
-		*m_editRowIter += *nextLine;
-		m_lines.erase(nextLine);
+		m_buffer.join(m_editRow);
+		m_journal.join(m_editRow);
 
 		if (isUndoable)
 		{
@@ -300,8 +509,9 @@ void StudentTextEditor::undoableDel(bool isUndoable)
 	// otherwise, erase char and inform undo (if asked to)
 	else
 	{
-		char ch = m_editRowIter->at(m_editCol);
-		m_editRowIter->erase(m_editCol, 1);
+		char ch = m_buffer.at(m_editRow, m_editCol);
+		m_buffer.erase(m_editRow, m_editCol, 1);
+		m_journal.erase(m_editRow, m_editCol, 1);
 
 		if (isUndoable)
 		{
@@ -309,6 +519,7 @@ void StudentTextEditor::undoableDel(bool isUndoable)
 		}
 	}
 }
+
 void StudentTextEditor::undoableBackspace(bool isUndoable)
 {
 	// if at top of doc, don't do anything
@@ -321,14 +532,12 @@ void StudentTextEditor::undoableBackspace(bool isUndoable)
 	else if (m_editCol == 0)
 	{
 		// update row and col trackers
-		auto lineCopy = m_editRowIter;
-		--m_editRowIter;
 		--m_editRow;
-		m_editCol = m_editRowIter->size();
+		m_editCol = m_buffer.lineLength(m_editRow);
 
-		// merge lines and erase bottom line
-		*m_editRowIter += *lineCopy;
-		m_lines.erase(lineCopy);
+		// merge lines, removing the bottom one
+		m_buffer.join(m_editRow);
+		m_journal.join(m_editRow);
 
 		if (isUndoable)
 		{
@@ -339,8 +548,9 @@ void StudentTextEditor::undoableBackspace(bool isUndoable)
 	// else, delete char to left of editCol
 	else
 	{
-		char ch = m_editRowIter->at(m_editCol - 1);
-		m_editRowIter->erase(m_editCol - 1, 1);
+		char ch = m_buffer.at(m_editRow, m_editCol - 1);
+		m_buffer.erase(m_editRow, m_editCol - 1, 1);
+		m_journal.erase(m_editRow, m_editCol - 1, 1);
 		--m_editCol;
 
 		if (isUndoable)
@@ -349,26 +559,30 @@ void StudentTextEditor::undoableBackspace(bool isUndoable)
 		}
 	}
 }
+
 void StudentTextEditor::undoableInsert(char ch, bool isUndoable)
 {
-	// add char depending on value (tab separate case)
+	// a tab is four spaces, each undone like a typed one
 	if (ch == '\t')
 	{
-		m_editRowIter->insert(m_editCol, "    "); // tab case
-		m_editCol += 4;
-	}
-	else
-	{
-		m_editRowIter->insert(m_editCol, 1, ch); // insert 1 inst of ch at editcol
-		++m_editCol;
+		for (int i = 0; i < 4; ++i)
+		{
+			undoableInsert(' ', isUndoable);
+		}
+		return;
 	}
 
+	m_buffer.insert(m_editRow, m_editCol, string_view(&ch, 1)); // insert 1 inst of ch at editcol
+	m_journal.insert(m_editRow, m_editCol, string_view(&ch, 1));
+	++m_editCol;
+
 	// UNDO obj tracking
 	if (isUndoable)
 	{
 		getUndo()->submit(Undo::Action::INSERT, m_editRow, m_editCol, ch);
 	}
 }
+
 void StudentTextEditor::undoableEnter(bool isUndoable)
 {
 	// UNDO obj tracking
@@ -377,23 +591,9 @@ void StudentTextEditor::undoableEnter(bool isUndoable)
 		getUndo()->submit(Undo::Action::SPLIT, m_editRow, m_editCol);
 	}
 
-	// make new line if at the end of a page
-	if (m_editRow == m_lines.size() - 1 && m_editCol == m_editRowIter->size())
-	{
-		m_lines.push_back("");
-		++m_editRow;
-		++m_editRowIter;
-		m_editCol = 0;
-	}
-	// otherwise, make a new line for all chars from col - 1 to end, edit current row
-	else
-	{
-		string nextLine = m_editRowIter->substr(m_editCol, string::npos);
-		*m_editRowIter = m_editRowIter->substr(0, m_editCol);
-
-		// add new line, update row and col counters
-		m_editRowIter = m_lines.emplace(++m_editRowIter, nextLine);
-		++m_editRow;
-		m_editCol = 0;
-	}
-}
\ No newline at end of file
+	// move all chars from col to end onto a new line below, cursor to its start
+	m_buffer.split(m_editRow, m_editCol);
+	m_journal.split(m_editRow, m_editCol);
+	++m_editRow;
+	m_editCol = 0;
+}
@@ -2,11 +2,11 @@
 #define STUDENTTEXTEDITOR_H_
 
 #include "TextEditor.h"
-#include <list>
+#include "EditJournal.h"
+#include "TextBuffer.h"
+#include "Undo.h"
 #include <string>
 
-class Undo;
-
 class StudentTextEditor : public TextEditor {
 public:
 
@@ -16,6 +16,7 @@ public:
 	bool save(std::string file);
 	void reset();
 	void move(Dir dir);
+	void moveTo(int row, int col);
 	void del();
 	void backspace();
 	void insert(char ch);
@@ -23,14 +24,21 @@ public:
 	void getPos(int& row, int& col) const;
 	int getLines(int startRow, int numRows, std::vector<std::string>& lines) const;
 	void undo();
+	void redo();
+	bool applyEdits(const std::vector<Edit>& edits);
+	bool find(const TextSearch& search, int& length);
+	int replaceAll(const TextSearch& search, const std::string& replacement);
+	bool recovered() const;
 
 private:
-	std::list<std::string> m_lines;
-	std::list<std::string>::iterator m_editRowIter; 
+	TextBuffer m_buffer;
+	EditJournal m_journal; // of every change to m_buffer since it was loaded or saved
 	int m_editRow;
 	int m_editCol;
+	bool m_recovered;
 
 	void moveCursor(int row, int col);
+	void replay(Undo::Action action, int row, int col, int count, const std::string& text);
 	void undoableDel(bool isUndoable);
 	void undoableBackspace(bool isUndoable);
 	void undoableInsert(char ch, bool isUndoable);
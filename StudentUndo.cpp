@@ -1,68 +1,226 @@
 #include "StudentUndo.h"
+#include "AtomicFileWriter.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
+namespace
+{
+	uint64_t steadyMs()
+	{
+		return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// as the spell checker counts them
+	bool isWordChar(char ch)
+	{
+		return isalpha(static_cast<unsigned char>(ch)) || ch == '\'';
+	}
+
+	const char HISTORY_MAGIC[8] = {'W', 'U', 'R', 'D', 'U', 'N', 'D', 'O'};
+	const uint32_t HISTORY_VERSION = 2;
+	const uint32_t ORDER_MARK = 0x01020304; // reads back differently on a machine of the other endianness
+	// a file this much bigger than twice the history it holds is written afresh
+	const uint64_t HISTORY_SLACK = 1 << 20;
+
+	struct HistoryHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint32_t nodeSize; // node records are as they lie in memory
+		uint32_t reserved;
+	};
+
+	// followed by nodeCount node records, the last of them the newest, then their text, then where
+	// redo goes from the current node on, as pathLength node numbers
+	struct ChunkHeader
+	{
+		uint64_t size; // of the whole chunk
+		uint64_t checksum; // of all of it after this field
+		uint64_t contentHash; // of the document where the current node leaves it
+		uint64_t documentSize; // and its size and modification time as saved there
+		int64_t documentMtime;
+		int64_t firstNode;
+		int64_t nodeCount;
+		int64_t firstKept; // the oldest node not yet dropped, which may be in an earlier chunk
+		uint64_t textStart; // where the first node's text starts
+		uint64_t textSize;
+		int32_t current;
+		int32_t lastGroup;
+		int64_t pathLength;
+	};
+	const size_t CHECKSUMMED_FROM = 2 * sizeof(uint64_t);
+
+	uint64_t chunkChecksum(const char *chunk, size_t size)
+	{
+		ContentHash checksum;
+		checksum.add(string_view(chunk + CHECKSUMMED_FROM, size - CHECKSUMMED_FROM));
+		return checksum.value();
+	}
+
+	bool appendFile(const string &path, const string &data)
+	{
+		int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+		if (fd < 0)
+		{
+			return false;
+		}
+		size_t done = 0;
+		while (done < data.size())
+		{
+			ssize_t n = write(fd, data.data() + done, data.size() - done);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (n <= 0)
+			{
+				break;
+			}
+			done += n;
+		}
+		return close(fd) == 0 && done == data.size();
+	}
+}
+
 Undo *createUndo()
 {
 	return new StudentUndo;
 }
 
-StudentUndo::~StudentUndo()
+StudentUndo::StudentUndo(size_t memoryLimit)
+	: m_limit(memoryLimit), m_groupDepth(0), m_lastGroup(0), m_lastTime(0), m_submitted(0), m_recorded(0),
+	  m_loadedHash(0), m_uncheckedEnd(0)
 {
 	clear();
 }
 
 void StudentUndo::submit(const Action action, int row, int col, char ch)
 {
-	string text;
-	// consider batching only if there are old actions
-	if (!m_actions.empty())
+	int group = m_groupDepth > 0 ? m_lastGroup : 0;
+	uint64_t now = m_coalescing.clock ? m_coalescing.clock() : steadyMs();
+	bool paused = m_coalescing.pauseMs > 0 && now - m_lastTime > static_cast<uint64_t>(m_coalescing.pauseMs);
+	m_lastTime = now;
+	++m_submitted;
+
+	// if batching conditions met, grow the newest node in place: O(1) amortized, so a long burst of
+	// typing isn't quadratic. Only the newest can grow, as nothing has been built on it
+	int newest = newestIndex();
+	if (m_current == newest && !paused && !m_reopened && canBatch(node(newest), action, row, col, group, ch))
 	{
-		Undoable *top = m_actions.top();
-		bool deleteCond = action == DELETE && top->m_col == col;
-		bool backspaceCond = action == DELETE && top->m_col - 1 == col;
-		bool insertCond = action == INSERT && top->m_col + 1 == col;
-		// if batching conditions met, combine text and get rid of top
-		if (top->m_action == action && top->m_row == row && (deleteCond || backspaceCond || insertCond))
+		Node &top = node(newest);
+		if (action == SPLIT)
 		{
-			if (backspaceCond)
-			{
-				text += ch + top->m_text;
-			}
-			else
-			{
-				text += top->m_text + ch;
-			}
-			// text += top->m_text + ch;
-			delete top;
-			m_actions.pop();
+			ch = '\n';
+			++m_endRow;
+			m_endCol = 0;
+		}
+		else if (action == INSERT)
+		{
+			m_endCol = col;
 		}
+		else if (top.col - 1 == col)
+		{
+			m_before += ch;
+			top.col = col;
+			m_lastChar = ch;
+			return;
+		}
+		m_text.push_back(ch);
+		++top.textEnd;
+		m_lastChar = ch;
+		return;
 	}
 
-	// if batching not done, set text to ch
-	if (text.size() == 0)
+	// otherwise add a node under the current one, which redo now goes to; an insert's col is after
+	// its char, and the node's where it starts
+	seal();
+	m_reopened = false;
+	bool hasText = action == INSERT || action == DELETE;
+	Node added = { m_current, -1, -1, -1, row, action == INSERT ? col - 1 : col, group, static_cast<uint8_t>(action), node(newest).textEnd + hasText };
+	m_endRow = row;
+	m_endCol = col;
+	m_lastChar = ch;
+	++m_recorded;
+	if (hasText)
+	{
+		m_text.push_back(ch);
+	}
+	if (kept(m_current))
+	{
+		Node &parent = node(m_current);
+		added.older = parent.newest;
+		parent.newest = parent.child = newest + 1;
+	}
+	else
 	{
-		text += ch;
+		m_topRedo = newest + 1;
 	}
+	m_nodes.push_back(added);
+	m_current = newest + 1;
 
-	// add undoable
-	Undoable *newUndoable = new Undoable(action, row, col, text);
-	m_actions.push(newUndoable);
+	// over the limit: the oldest go, but never this one
+	while (memoryUsed() > m_limit && m_first < m_current)
+	{
+		dropOldest(m_current);
+	}
+}
+
+void StudentUndo::submitText(const Action action, int row, int col, const std::string &text)
+{
+	if (text.empty() || (action != INSERT && action != DELETE))
+	{
+		Undo::submitText(action, row, col, text);
+		return;
+	}
+
+	// O(text): the first char goes in as submit() would put it, which leaves the newest node ready to
+	// batch the rest, so it takes them all at once
+	submit(action, row, action == INSERT ? col + 1 : col, text[0]);
+	Node &top = node(newestIndex());
+	m_text.insert(m_text.end(), text.begin() + 1, text.end());
+	top.textEnd += text.size() - 1;
+	if (action == INSERT)
+	{
+		m_endCol = col + text.size();
+	}
+	m_lastChar = text.back();
+	m_submitted += text.size() - 1;
+
+	// the rest may have taken it over the limit even if the first char didn't
+	while (memoryUsed() > m_limit && m_first < m_current)
+	{
+		dropOldest(m_current);
+	}
 }
 
 StudentUndo::Action StudentUndo::get(int &row, int &col, int &count, std::string &text)
 {
-	// no undoable actions performed, so return err
-	if (m_actions.empty())
+	// no undoable actions performed (or kept), so return err
+	checkLoaded();
+	seal();
+	if (!kept(m_current) || node(m_current).action == ERROR)
 	{
+		m_gotGroup = 0;
 		return ERROR;
 	}
+	const Node &top = node(m_current);
 
 	// determine inverse action
-	Undoable *top = m_actions.top();
 	Action inverseAction;
-	switch (top->m_action)
+	switch (top.action)
 	{
 	case INSERT:
 		inverseAction = DELETE;
@@ -77,28 +235,29 @@ StudentUndo::Action StudentUndo::get(int &row, int &col, int &count, std::string
 		inverseAction = JOIN;
 		break;
 	// error case should never occur, just listed for switch statement completeness
-	case ERROR:
+	default:
 		inverseAction = ERROR;
 		break;
 	}
 
 	// set count and col param
+	string batched = textOf(m_current);
 	if (inverseAction == DELETE)
 	{
-		// starting pos to delete different from other inverses
-		count = top->m_text.size();
-		col = top->m_col - count;
+		// from where the insert started, line ends included
+		count = batched.size();
+		col = top.col;
 	}
 	else
 	{
 		count = 1;
-		col = top->m_col;
+		col = top.col;
 	}
 
 	// set text param, only insert has text
 	if (inverseAction == INSERT)
 	{
-		text = top->m_text;
+		text = batched;
 	}
 	else
 	{
@@ -106,23 +265,478 @@ StudentUndo::Action StudentUndo::get(int &row, int &col, int &count, std::string
 	}
 
 	// set row
-	row = top->m_row; // universal for all actions
+	row = top.row; // universal for all actions
 
+	// move up to the parent, which redoes this next
+	m_gotGroup = top.group;
+	m_redoing = false;
+	int undone = m_current;
+	m_current = top.parent;
+	if (kept(m_current))
+	{
+		node(m_current).child = undone;
+	}
+	else
+	{
+		m_topRedo = undone;
+	}
+	return inverseAction;
+}
 
-	// pop top
-	delete top;
-	m_actions.pop();
+StudentUndo::Action StudentUndo::redo(int &row, int &col, int &count, std::string &text)
+{
+	checkLoaded();
+	seal();
+	int next = kept(m_current) ? node(m_current).child : m_topRedo;
+	if (!kept(next))
+	{
+		m_gotGroup = 0;
+		return ERROR;
+	}
+	const Node &redone = node(next);
 
-	return inverseAction;
+	// the change as it was made: a delete's col is where it ended up
+	Action action = static_cast<Action>(redone.action);
+	string batched = textOf(next);
+	count = action == INSERT || action == DELETE ? batched.size() : 1;
+	col = redone.col;
+	text = action == INSERT ? batched : "";
+	row = redone.row;
+
+	m_gotGroup = redone.group;
+	m_redoing = true;
+	m_current = next;
+	return action;
 }
 
 void StudentUndo::clear()
 {
-	// clear undo stack
-	while (!m_actions.empty())
+	// O(1): just the root is left, and the arrays' memory is kept for the next document
+	m_nodes.clear();
+	m_text.clear();
+	m_before.clear();
+	m_nodes.push_back(Node{ -1, -1, -1, -1, 0, 0, 0, ERROR, 0 });
+	m_nodeBase = m_first = 0;
+	m_textBase = m_textFirst = 0;
+	m_current = 0;
+	m_topRedo = -1;
+	m_endRow = m_endCol = 0;
+	m_lastChar = 0;
+	m_reopened = false;
+	m_checkHash = nullptr;
+	m_historyPath.clear();
+	m_historyWritten = 0;
+	m_historyBytes = 0;
+	m_gotGroup = 0;
+	m_redoing = false;
+}
+
+void StudentUndo::beginGroup()
+{
+	// only the outermost group starts a new one
+	if (m_groupDepth++ == 0)
+	{
+		++m_lastGroup;
+	}
+}
+
+void StudentUndo::endGroup()
+{
+	if (m_groupDepth > 0)
+	{
+		--m_groupDepth;
+	}
+}
+
+bool StudentUndo::moreInGroup() const
+{
+	if (m_gotGroup == 0)
+	{
+		return false;
+	}
+	int next = m_current;
+	if (m_redoing)
+	{
+		next = kept(m_current) ? node(m_current).child : m_topRedo;
+	}
+	return kept(next) && node(next).group == m_gotGroup;
+}
+
+int StudentUndo::branches() const
+{
+	// O(branches)
+	int count = 0;
+	for (int child = kept(m_current) ? node(m_current).newest : -1; kept(child); child = node(child).older)
+	{
+		++count;
+	}
+	return count;
+}
+
+int StudentUndo::nextBranch()
+{
+	// the next older child, or from the newest again
+	checkLoaded();
+	if (branches() < 2)
+	{
+		return 0;
+	}
+	seal();
+	Node &parent = node(m_current);
+	int next = node(parent.child).older;
+	parent.child = kept(next) ? next : parent.newest;
+
+	// numbered oldest first
+	int number = 1;
+	for (int child = node(parent.child).older; kept(child); child = node(child).older)
+	{
+		++number;
+	}
+	return number;
+}
+
+bool StudentUndo::saveHistory(const std::string &path, uint64_t size, int64_t mtime, uint64_t hash)
+{
+	// O(nodes and text since the last save): appended, unless the file is new to this history or
+	// mostly what has since been dropped. A loaded history goes out again only once it is checked
+	checkLoaded();
+	seal();
+	if (path == m_historyPath && m_historyBytes <= 2 * memoryUsed() + HISTORY_SLACK)
+	{
+		string chunk = historyChunk(max(m_historyWritten, m_first), size, mtime, hash);
+		if (appendFile(path, chunk))
+		{
+			m_historyBytes += chunk.size();
+			m_historyWritten = newestIndex();
+			return true;
+		}
+	}
+
+	// afresh, which replaces a file an append failed partway through too
+	m_historyPath.clear();
+	HistoryHeader header = {};
+	memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+	header.version = HISTORY_VERSION;
+	header.byteOrder = ORDER_MARK;
+	header.nodeSize = sizeof(Node);
+	string chunk = historyChunk(m_first, size, mtime, hash);
+	AtomicFileWriter file;
+	if (!file.open(path))
+	{
+		return false;
+	}
+	file.write(string_view(reinterpret_cast<const char *>(&header), sizeof(header)));
+	file.write(chunk);
+	if (!file.commit())
+	{
+		return false;
+	}
+	m_historyPath = path;
+	m_historyBytes = sizeof(header) + chunk.size();
+	m_historyWritten = newestIndex();
+	return true;
+}
+
+bool StudentUndo::loadHistory(const std::string &path, uint64_t size, int64_t mtime, std::function<uint64_t()> hash)
+{
+	// O(file), but no more than checking it and copying it in: node records and text go in as they are.
+	// The document itself is only hashed once the history is used; see checkLoaded()
+	MappedFile file;
+	HistoryHeader header;
+	if (!file.open(path) || file.size() < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, HISTORY_MAGIC, sizeof(header.magic)) != 0 || header.version != HISTORY_VERSION ||
+		header.byteOrder != ORDER_MARK || header.nodeSize != sizeof(Node))
+	{
+		return false;
+	}
+
+	// the chunks up to the first torn or unwritten one; the last must be of this document
+	vector<size_t> chunks;
+	size_t pos = sizeof(header);
+	ChunkHeader chunk;
+	while (file.size() - pos >= sizeof(chunk))
+	{
+		memcpy(&chunk, file.data() + pos, sizeof(chunk));
+		uint64_t room = file.size() - pos - sizeof(chunk);
+		if (chunk.nodeCount < 1 || chunk.pathLength < 0 || static_cast<uint64_t>(chunk.nodeCount) > room / sizeof(Node) ||
+			chunk.textSize > room || static_cast<uint64_t>(chunk.pathLength) > room / sizeof(int32_t) ||
+			chunk.size != sizeof(chunk) + chunk.nodeCount * sizeof(Node) + chunk.textSize + chunk.pathLength * sizeof(int32_t) ||
+			chunk.size > file.size() - pos || chunk.checksum != chunkChecksum(file.data() + pos, chunk.size))
+		{
+			break;
+		}
+		chunks.push_back(pos);
+		pos += chunk.size;
+	}
+	if (chunks.empty())
+	{
+		return false;
+	}
+	memcpy(&chunk, file.data() + chunks.back(), sizeof(chunk));
+	if (chunk.documentSize != size || chunk.documentMtime != mtime)
+	{
+		return false;
+	}
+
+	// each chunk carries on from the newest node of the one before, which it has again as it may
+	// have grown; after a gap, where nodes were dropped before they were saved, it starts afresh
+	clear();
+	m_nodes.clear();
+	int64_t base = -1;
+	for (size_t at : chunks)
+	{
+		memcpy(&chunk, file.data() + at, sizeof(chunk));
+		if (base < 0 || chunk.firstNode < base || chunk.firstNode - base > static_cast<int64_t>(m_nodes.size()) ||
+			chunk.textStart < m_textBase || chunk.textStart - m_textBase > m_text.size())
+		{
+			m_nodes.clear();
+			m_text.clear();
+			base = chunk.firstNode;
+			m_textBase = chunk.textStart;
+		}
+		m_nodes.resize(chunk.firstNode - base);
+		m_text.resize(chunk.textStart - m_textBase);
+		const char *records = file.data() + at + sizeof(chunk);
+		size_t count = m_nodes.size();
+		m_nodes.resize(count + chunk.nodeCount);
+		memcpy(&m_nodes[count], records, chunk.nodeCount * sizeof(Node));
+		m_text.insert(m_text.end(), records + chunk.nodeCount * sizeof(Node), records + chunk.nodeCount * sizeof(Node) + chunk.textSize);
+	}
+	m_nodeBase = m_first = base;
+	m_textFirst = m_textBase;
+
+	// not trusting it any further than the checksums go
+	bool valid = base >= 0 && base + static_cast<int64_t>(m_nodes.size()) <= INT32_MAX && chunk.current >= -1 &&
+		chunk.current <= newestIndex() && chunk.firstKept >= base && chunk.firstKept <= newestIndex();
+	uint64_t textEnd = m_textBase;
+	for (int i = m_first; valid && i <= newestIndex(); ++i)
+	{
+		const Node &record = node(i);
+		valid = record.parent < i && record.action <= JOIN && record.textEnd >= textEnd;
+		textEnd = record.textEnd;
+	}
+	if (!valid || textEnd != m_textBase + m_text.size())
+	{
+		clear();
+		return false;
+	}
+
+	// what was dropped before the last save stays dropped; where the document is, and what redo goes
+	// on to from there
+	if (chunk.firstKept > m_first)
+	{
+		m_textFirst = node(chunk.firstKept - 1).textEnd;
+		m_first = chunk.firstKept;
+	}
+	m_current = chunk.current;
+	m_lastGroup = max(m_lastGroup, static_cast<int>(chunk.lastGroup));
+	relink();
+	const char *redoPath = file.data() + chunks.back() + sizeof(chunk) + chunk.nodeCount * sizeof(Node) + chunk.textSize;
+	int from = m_current;
+	for (int64_t i = 0; i < chunk.pathLength; ++i)
+	{
+		int32_t next;
+		memcpy(&next, redoPath + i * sizeof(next), sizeof(next));
+		if (next <= from || next > newestIndex() || node(next).parent != from)
+		{
+			break;
+		}
+		if (kept(from))
+		{
+			node(from).child = next;
+		}
+		else
+		{
+			m_topRedo = next;
+		}
+		from = next;
+	}
+
+	// the next edit, in this session, is a step of its own
+	m_reopened = true;
+	m_checkHash = std::move(hash);
+	m_loadedHash = chunk.contentHash;
+	m_uncheckedEnd = newestIndex() + 1;
+
+	// later saves append to the file, unless it had a torn end
+	if (pos == file.size())
+	{
+		m_historyPath = path;
+		m_historyWritten = newestIndex();
+		m_historyBytes = pos;
+	}
+	return true;
+}
+
+void StudentUndo::setMemoryLimit(size_t bytes)
+{
+	m_limit = bytes;
+	while (memoryUsed() > m_limit && m_first < newestIndex())
 	{
-		Undoable *top = m_actions.top();
-		delete top;
-		m_actions.pop();
+		dropOldest(newestIndex());
 	}
-}
\ No newline at end of file
+}
+
+size_t StudentUndo::memoryUsed() const
+{
+	size_t nodes = newestIndex() + 1 - m_first;
+	return nodes * sizeof(Node) + (m_textBase + m_text.size() - m_textFirst) + m_before.size();
+}
+
+string StudentUndo::historyChunk(int first, uint64_t size, int64_t mtime, uint64_t hash) const
+{
+	// O(nodes from first on and their text): a ChunkHeader, the node records, their text, the redo path
+	int newest = newestIndex();
+	uint64_t textStart = first == m_first ? m_textFirst : node(first - 1).textEnd;
+	vector<int32_t> redoPath;
+	for (int next = kept(m_current) ? node(m_current).child : m_topRedo; kept(next); next = node(next).child)
+	{
+		redoPath.push_back(next);
+	}
+
+	ChunkHeader header = {};
+	header.contentHash = hash;
+	header.documentSize = size;
+	header.documentMtime = mtime;
+	header.firstNode = first;
+	header.nodeCount = newest + 1 - first;
+	header.firstKept = m_first;
+	header.textStart = textStart;
+	header.textSize = node(newest).textEnd - textStart;
+	header.current = m_current;
+	header.lastGroup = m_lastGroup;
+	header.pathLength = redoPath.size();
+	header.size = sizeof(header) + header.nodeCount * sizeof(Node) + header.textSize + redoPath.size() * sizeof(int32_t);
+
+	string chunk;
+	chunk.reserve(header.size);
+	chunk.append(reinterpret_cast<const char *>(&header), sizeof(header));
+	chunk.append(reinterpret_cast<const char *>(&node(first)), header.nodeCount * sizeof(Node));
+	chunk.append(m_text.data() + (textStart - m_textBase), header.textSize);
+	chunk.append(reinterpret_cast<const char *>(redoPath.data()), redoPath.size() * sizeof(int32_t));
+	header.checksum = chunkChecksum(chunk.data(), chunk.size());
+	memcpy(&chunk[sizeof(header.size)], &header.checksum, sizeof(header.checksum));
+	return chunk;
+}
+
+void StudentUndo::checkLoaded()
+{
+	// O(document) once, for the hash, if a history was loaded. A document changed without its size or
+	// time changing loses the loaded nodes, but not those submitted since, which are undone up to
+	// where they started, as if the loaded ones had been dropped for memory
+	if (!m_checkHash)
+	{
+		return;
+	}
+	uint64_t hash = m_checkHash();
+	m_checkHash = nullptr;
+	if (hash == m_loadedHash)
+	{
+		return;
+	}
+	if (newestIndex() < m_uncheckedEnd)
+	{
+		clear();
+		return;
+	}
+	while (m_first < m_uncheckedEnd)
+	{
+		dropOldest(m_uncheckedEnd);
+	}
+	m_historyPath.clear();
+}
+
+void StudentUndo::relink()
+{
+	// O(nodes): each node's children, newest first, as they were added; redo goes to the newest
+	for (int i = m_first; i <= newestIndex(); ++i)
+	{
+		node(i).child = node(i).newest = node(i).older = -1;
+	}
+	for (int i = m_first; i <= newestIndex(); ++i)
+	{
+		int parent = node(i).parent;
+		if (kept(parent))
+		{
+			node(i).older = node(parent).newest;
+			node(parent).newest = node(parent).child = i;
+		}
+	}
+}
+
+string StudentUndo::textOf(int index) const
+{
+	// O(text); the newest node's must be sealed first
+	uint64_t start = index == m_first ? m_textFirst : node(index - 1).textEnd;
+	return string(m_text.data() + (start - m_textBase), node(index).textEnd - start);
+}
+
+bool StudentUndo::canBatch(const Node &top, Action action, int row, int col, int group, char ch) const
+{
+	// top is the newest node, so m_endRow and m_endCol are where it has got to
+	if (top.group != group || (m_coalescing.words && isWordChar(ch) && !isWordChar(m_lastChar)))
+	{
+		return false;
+	}
+	bool deleteCond = action == DELETE && top.action == DELETE && top.row == row && top.col == col;
+	bool backspaceCond = action == DELETE && top.action == DELETE && top.row == row && top.col - 1 == col;
+	bool insertCond = action == INSERT && top.action == INSERT && m_endRow == row && m_endCol + 1 == col;
+	bool enterCond = action == SPLIT && top.action == INSERT && m_coalescing.acrossLines && m_endRow == row && m_endCol == col;
+	return deleteCond || backspaceCond || insertCond || enterCond;
+}
+
+void StudentUndo::seal()
+{
+	// O(text of the newest node): put the backspaces batched onto it in front of its text
+	if (m_before.empty())
+	{
+		return;
+	}
+	Node &top = node(newestIndex());
+	uint64_t start = newestIndex() == m_first ? m_textFirst : node(newestIndex() - 1).textEnd;
+	m_text.insert(m_text.begin() + (start - m_textBase), m_before.rbegin(), m_before.rend());
+	top.textEnd += m_before.size();
+	m_before.clear();
+}
+
+void StudentUndo::dropOldest(int keepFrom)
+{
+	// the oldest node, and the rest of its group, up to keepFrom. Whatever led on from the current
+	// node, if it goes, is what redo goes to
+	int group = -1;
+	while (m_first < keepFrom)
+	{
+		const Node &oldest = node(m_first);
+		if (group >= 0 && (group == 0 || oldest.group != group))
+		{
+			break;
+		}
+		group = oldest.group;
+		if (m_first == m_current)
+		{
+			m_topRedo = oldest.child;
+		}
+		else if (m_first == m_topRedo)
+		{
+			m_topRedo = -1;
+		}
+		m_textFirst = oldest.textEnd;
+		++m_first;
+	}
+
+	// amortized O(1): once most of either array has been dropped, move what's left to the front
+	if (m_first - m_nodeBase > static_cast<int>(m_nodes.size() / 2))
+	{
+		m_nodes.erase(m_nodes.begin(), m_nodes.begin() + (m_first - m_nodeBase));
+		m_nodeBase = m_first;
+	}
+	if (m_textFirst - m_textBase > m_text.size() / 2)
+	{
+		m_text.erase(m_text.begin(), m_text.begin() + (m_textFirst - m_textBase));
+		m_textBase = m_textFirst;
+	}
+}
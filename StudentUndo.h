@@ -1,29 +1,124 @@
 #ifndef STUDENTUNDO_H_
 #define STUDENTUNDO_H_
 
-#include <stack>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
+#include <vector>
 #include "Undo.h"
 
+// The undo history is a tree of changes: undoing one moves back to its parent without discarding it,
+// so it can be redone, and a change made after undoing starts a new branch beside it. The nodes are
+// small fixed-size records in one array, in the order they were made, linked by index to their
+// parent, newest child and next older sibling; their text lies in the same order in one shared arena,
+// so a node's text runs from where the one before it ends to where it ends. A keystroke that batches
+// onto the newest node costs a byte of arena, and how keystrokes are batched is set by a Coalescing
+// policy: by default a burst of typing is one node even across Enter, and a pause ends it. When the
+// history passes its memory limit the oldest nodes (whole groups at a time) are dropped; what they
+// led to becomes the top, past which nothing is undone. clear() is O(1), keeping the memory for reuse.
+//
+// The history can be kept in a file beside the document: each save appends a chunk with the nodes made
+// since the last (the newest again, as it may have grown since) and their text, as they lie in memory,
+// and where the document is in the tree. Reopening maps the file and copies each chunk's nodes and
+// text in one go, then relinks the tree in one pass. Once most of the file is nodes since dropped, the
+// next save writes it afresh. Each chunk records the document's size and modification time, which
+// reopening compares; the document's text is hashed only on the first undo, redo or save after that.
 class StudentUndo : public Undo
 {
 public:
+	static const size_t DEFAULT_MEMORY_LIMIT = 64 << 20;
+
+	// When a keystroke is batched onto the newest node, to be undone with it, rather than starting
+	// another. Only ever a keystroke continuing it in the same line, or these allow it
+	struct Coalescing
+	{
+		bool acrossLines = true; // Enter at the end of text being typed carries on with it
+		int pauseMs = 2000; // a longer pause between keystrokes ends it; 0 for no limit
+		bool words = false; // so does starting a word (letters and apostrophes) after anything else
+		uint64_t (*clock)() = nullptr; // in ms, for pauses; std::chrono::steady_clock if null
+	};
+
+	explicit StudentUndo(size_t memoryLimit = DEFAULT_MEMORY_LIMIT);
+	void setCoalescing(const Coalescing &coalescing) { m_coalescing = coalescing; }
 	void submit(Action action, int row, int col, char ch = 0);
+	// the text counts as one keystroke: it is never split by a pause or word
+	void submitText(Action action, int row, int col, const std::string &text);
 	Action get(int &row, int &col, int &count, std::string &text);
 	void clear();
-	~StudentUndo();
+	void beginGroup();
+	void endGroup();
+	bool moreInGroup() const;
+	Action redo(int &row, int &col, int &count, std::string &text);
+	int branches() const;
+	int nextBranch();
+	bool saveHistory(const std::string &path, uint64_t size, int64_t mtime, uint64_t hash);
+	bool loadHistory(const std::string &path, uint64_t size, int64_t mtime, std::function<uint64_t()> hash);
+
+	// bytes of history kept before the oldest is dropped; the newest node is always kept
+	void setMemoryLimit(size_t bytes);
+	size_t memoryUsed() const;
+	// since construction: keystrokes submitted (each char of submitText() counting), and the nodes
+	// they made
+	size_t submitted() const { return m_submitted; }
+	size_t recorded() const { return m_recorded; }
 
 private:
-	struct Undoable
+	struct Node
 	{
-		Action m_action;
-		int m_row;
-		int m_col;
-		std::string m_text;
-
-		Undoable(Action action, int row, int col, std::string text) : m_action(action), m_row(row), m_col(col), m_text(text) {}
+		int32_t parent;
+		int32_t child; // the one redo() goes to, or -1
+		int32_t newest; // child, or -1; the others are linked through older
+		int32_t older; // sibling, or -1
+		int32_t row; // where it starts if an INSERT, which may run over several lines
+		int32_t col;
+		int32_t group; // or 0 if in none
+		uint8_t action; // ERROR for the root
+		uint64_t textEnd; // in the arena; its text starts where the node before it ends
 	};
-	std::stack<Undoable *> m_actions;
+
+	// nodes and text are numbered from the start of the history; the arrays hold them from m_nodeBase
+	// and m_textBase on, and those before m_first and m_textFirst have been dropped
+	std::vector<Node> m_nodes;
+	std::vector<char> m_text;
+	std::string m_before; // backspaces batched onto the newest node, which come before its text, in reverse
+	int m_nodeBase;
+	int m_first;
+	uint64_t m_textBase;
+	uint64_t m_textFirst;
+	size_t m_limit;
+	int m_current; // the node the document is at
+	int m_topRedo; // what redo() goes to once m_current has been dropped, or -1
+	int m_groupDepth;
+	int m_lastGroup; // the group being submitted to, if m_groupDepth > 0
+	int m_gotGroup; // of the last node get() or redo() returned
+	bool m_redoing; // whether that was redo()
+	Coalescing m_coalescing;
+	int m_endRow; // where the newest node has got to, if an INSERT
+	int m_endCol;
+	char m_lastChar; // the last one batched onto the newest node
+	uint64_t m_lastTime; // of the last submit()
+	size_t m_submitted;
+	size_t m_recorded;
+	std::string m_historyPath; // the file the history was last saved to or loaded from
+	int m_historyWritten; // nodes before this are in it for good
+	uint64_t m_historyBytes; // its size
+	bool m_reopened; // the newest node was loaded from it, so nothing more batches onto it
+	std::function<uint64_t()> m_checkHash; // until the history loaded from it is first used
+	uint64_t m_loadedHash; // what that must return for the nodes before m_uncheckedEnd to stay
+	int m_uncheckedEnd;
+
+	Node &node(int index) { return m_nodes[index - m_nodeBase]; }
+	const Node &node(int index) const { return m_nodes[index - m_nodeBase]; }
+	bool kept(int index) const { return index >= m_first; }
+	int newestIndex() const { return m_nodeBase + static_cast<int>(m_nodes.size()) - 1; }
+	std::string textOf(int index) const;
+	bool canBatch(const Node &top, Action action, int row, int col, int group, char ch) const;
+	void seal();
+	void dropOldest(int keepFrom);
+	std::string historyChunk(int first, uint64_t size, int64_t mtime, uint64_t hash) const;
+	void checkLoaded();
+	void relink();
 };
 
 #endif // STUDENTUNDO_H_
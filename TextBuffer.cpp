@@ -0,0 +1,507 @@
+#include "TextBuffer.h"
+#include "NewlineScanner.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+TextBuffer::TextBuffer()
+	: m_data(nullptr), m_size(0), m_linePool(pmr::pool_options{64, 4096}), m_gap(&m_linePool), m_gapOwned(-1)
+{
+	clear();
+}
+
+void TextBuffer::assign(std::string text)
+{
+	m_file.close();
+	m_text = std::move(text);
+	m_data = m_text.data();
+	m_size = m_text.size();
+	startIndex();
+}
+
+bool TextBuffer::load(const std::string &path)
+{
+	// O(1) for a regular file: map it and index only the first block of lines
+	MappedFile file;
+	if (file.open(path))
+	{
+		m_file.swap(file);
+		m_text.clear();
+		m_text.shrink_to_fit();
+		m_data = m_file.data();
+		m_size = m_file.size();
+		startIndex();
+		return true;
+	}
+
+	ifstream infile(path, ios::binary);
+	if (!infile)
+	{
+		return false;
+	}
+
+	// not mappable (a pipe or device); read it the slow way
+	assign(string(istreambuf_iterator<char>(infile), istreambuf_iterator<char>()));
+	return true;
+}
+
+void TextBuffer::clear()
+{
+	assign(string());
+}
+
+int TextBuffer::lineCount() const
+{
+	indexRest();
+	return m_lineCount;
+}
+
+std::string_view TextBuffer::line(int row) const
+{
+	int block, index;
+	locate(row, block, index);
+	return view(m_blocks[block].lines[index]);
+}
+
+int TextBuffer::lineLength(int row) const
+{
+	int block, index;
+	locate(row, block, index);
+	const Line &line = m_blocks[block].lines[index];
+	if (line.owned >= 0 && line.owned == m_gapOwned)
+	{
+		return m_gap.size();
+	}
+	return view(line).size();
+}
+
+char TextBuffer::at(int row, int col) const
+{
+	int block, index;
+	locate(row, block, index);
+	const Line &line = m_blocks[block].lines[index];
+	if (line.owned >= 0 && line.owned == m_gapOwned)
+	{
+		return m_gap.at(col);
+	}
+	return view(line)[col];
+}
+
+std::string TextBuffer::substr(int row, int col, int count) const
+{
+	int block, index;
+	locate(row, block, index);
+	const Line &line = m_blocks[block].lines[index];
+	if (line.owned >= 0 && line.owned == m_gapOwned)
+	{
+		return m_gap.substr(col, count);
+	}
+	return string(view(line).substr(col, count));
+}
+
+bool TextBuffer::inLoadedText(std::string_view text) const
+{
+	return text.data() >= m_data && text.data() + text.size() <= m_data + m_size;
+}
+
+void TextBuffer::insert(int row, int col, std::string_view text)
+{
+	Line &line = lineAt(row);
+	edit(line).insert(col, text);
+}
+
+void TextBuffer::erase(int row, int col, int count)
+{
+	Line &line = lineAt(row);
+	if (line.owned < 0 && col + count == line.size)
+	{
+		// trimming the end of a view needs no copy
+		line.size = col;
+		return;
+	}
+	edit(line).erase(col, count);
+}
+
+void TextBuffer::split(int row, int col)
+{
+	// the tail of a view is just a shorter view; an owned line has to copy its tail out
+	Line &line = lineAt(row);
+	Line tail;
+	if (line.owned < 0)
+	{
+		tail = Line{line.data + col, line.size - col, -1};
+		line.size = col;
+	}
+	else
+	{
+		// own() may grow m_owned, so only look the head up afterwards
+		tail = Line{nullptr, 0, -1};
+		pmr::string &tailText = own(tail);
+		pmr::string &text = own(line);
+		tailText.assign(text, col, string::npos);
+		text.erase(col);
+	}
+	insertLine(row + 1, tail);
+}
+
+void TextBuffer::join(int row)
+{
+	Line next = lineAt(row + 1);
+	Line &line = lineAt(row);
+	if (line.owned < 0 && next.owned < 0 && line.data + line.size == next.data)
+	{
+		// lines that were adjacent in the loaded text are still one view (only possible without a
+		// line break between them, i.e. after a split)
+		line.size += next.size;
+	}
+	else
+	{
+		pmr::string &text = own(line);
+		text.append(view(next));
+	}
+	release(next);
+	eraseLine(row + 1);
+}
+
+std::string_view TextBuffer::view(const Line &line) const
+{
+	if (line.owned >= 0)
+	{
+		if (line.owned == m_gapOwned)
+		{
+			return m_gap.text();
+		}
+		return m_owned[line.owned];
+	}
+	return string_view(line.data, line.size);
+}
+
+void TextBuffer::locate(int row, int &block, int &index) const
+{
+	if (row >= m_lineCount)
+	{
+		indexThrough(row);
+	}
+
+	// O(1) in the block of the previous lookup
+	if (row >= m_fingerStart && row - m_fingerStart < m_blocks[m_fingerBlock].lines.size())
+	{
+		block = m_fingerBlock;
+		index = row - m_fingerStart;
+		return;
+	}
+
+	// O(log blocks): descend the Fenwick tree, skipping whole subtrees of blocks that end before row
+	int target = row;
+	int blocks = m_blocks.size();
+	int pos = 0;
+	int step = 1;
+	while (step * 2 <= blocks)
+	{
+		step *= 2;
+	}
+	for (; step > 0; step /= 2)
+	{
+		if (pos + step <= blocks && m_tree[pos + step] <= row)
+		{
+			pos += step;
+			row -= m_tree[pos];
+		}
+	}
+
+	// one past the last line is the end of the last block
+	if (pos == blocks)
+	{
+		pos = blocks - 1;
+		row = m_blocks[pos].lines.size();
+	}
+	block = pos;
+	index = row;
+	m_fingerBlock = pos;
+	m_fingerStart = target - row;
+}
+
+TextBuffer::Line &TextBuffer::lineAt(int row)
+{
+	int block, index;
+	locate(row, block, index);
+	return m_blocks[block].lines[index];
+}
+
+std::pmr::string &TextBuffer::own(Line &line)
+{
+	// the first edit copies a view into a string of its own
+	if (line.owned >= 0)
+	{
+		if (line.owned == m_gapOwned)
+		{
+			settle();
+		}
+		return m_owned[line.owned];
+	}
+
+	if (m_freeOwned.empty())
+	{
+		line.owned = m_owned.size();
+		m_owned.emplace_back(&m_linePool);
+	}
+	else
+	{
+		line.owned = m_freeOwned.back();
+		m_freeOwned.pop_back();
+	}
+	pmr::string &text = m_owned[line.owned];
+	text.assign(line.data, line.size);
+	line.data = nullptr;
+	line.size = 0;
+	return text;
+}
+
+GapBuffer &TextBuffer::edit(Line &line)
+{
+	// O(1) while the same line is edited; moving on to another gives the last one its string back
+	if (line.owned < 0 || line.owned != m_gapOwned)
+	{
+		own(line);
+		settle();
+		m_gap.assign(std::move(m_owned[line.owned]));
+		m_gapOwned = line.owned;
+	}
+	return m_gap;
+}
+
+void TextBuffer::settle()
+{
+	if (m_gapOwned >= 0)
+	{
+		m_owned[m_gapOwned] = m_gap.take();
+		m_gapOwned = -1;
+	}
+}
+
+void TextBuffer::release(Line &line)
+{
+	if (line.owned >= 0)
+	{
+		if (line.owned == m_gapOwned)
+		{
+			m_gap.take();
+			m_gapOwned = -1;
+		}
+		m_owned[line.owned].clear();
+		m_freeOwned.push_back(line.owned);
+		line.owned = -1;
+	}
+}
+
+void TextBuffer::insertLine(int row, const Line &line)
+{
+	int block, index;
+	locate(row, block, index);
+	vector<Line> &lines = m_blocks[block].lines;
+	lines.insert(lines.begin() + index, line);
+
+	if (lines.size() <= MAX_BLOCK_LINES)
+	{
+		resized(block, 1);
+		return;
+	}
+
+	// full: move the back half into a new block after this one
+	Block half;
+	half.lines.assign(lines.begin() + lines.size() / 2, lines.end());
+	lines.resize(lines.size() / 2);
+	m_blocks.insert(m_blocks.begin() + block + 1, std::move(half));
+	rebuildIndex();
+}
+
+void TextBuffer::eraseLine(int row)
+{
+	int block, index;
+	locate(row, block, index);
+	vector<Line> &lines = m_blocks[block].lines;
+	lines.erase(lines.begin() + index);
+
+	if (!lines.empty() || m_blocks.size() == 1)
+	{
+		resized(block, -1);
+		return;
+	}
+
+	// empty blocks are dropped
+	m_blocks.erase(m_blocks.begin() + block);
+	rebuildIndex();
+}
+
+void TextBuffer::resized(int block, int delta)
+{
+	// O(log blocks); later blocks, including maybe the finger's, start delta rows further on
+	m_lineCount += delta;
+	if (m_fingerBlock > block)
+	{
+		m_fingerStart += delta;
+	}
+	for (int pos = block + 1; pos < m_tree.size(); pos += pos & -pos)
+	{
+		m_tree[pos] += delta;
+	}
+}
+
+void TextBuffer::rebuildIndex()
+{
+	// O(blocks): each node adds itself into the next node that covers it
+	m_tree.assign(m_blocks.size() + 1, 0);
+	m_lineCount = 0;
+	m_fingerBlock = 0;
+	m_fingerStart = 0;
+	for (int pos = 1; pos < m_tree.size(); ++pos)
+	{
+		m_tree[pos] += m_blocks[pos - 1].lines.size();
+		m_lineCount += m_blocks[pos - 1].lines.size();
+		int parent = pos + (pos & -pos);
+		if (parent < m_tree.size())
+		{
+			m_tree[parent] += m_tree[pos];
+		}
+	}
+}
+
+void TextBuffer::startIndex()
+{
+	// forget every line, handing back the pool in one go, and index the first block, so there is
+	// always at least one
+	m_gap.take();
+	m_gapOwned = -1;
+	m_owned = vector<pmr::string>();
+	m_freeOwned.clear();
+	m_linePool.release();
+	m_blocks.clear();
+	m_indexed = 0;
+	rebuildIndex();
+	indexBlock();
+}
+
+bool TextBuffer::indexThrough(int row) const
+{
+	while (row >= m_lineCount && m_indexed <= m_size)
+	{
+		indexBlock();
+	}
+	return row < m_lineCount;
+}
+
+void TextBuffer::indexBlock() const
+{
+	// O(lines in the block), touching only the pages they are on
+	vector<Block> blocks;
+	size_t pos = scanLines(m_indexed, m_size, LOAD_BLOCK_LINES, blocks);
+	// a final '\n' ends the last line rather than starting another
+	m_indexed = pos < m_size ? pos : m_size + 1;
+	appendBlocks(blocks);
+}
+
+void TextBuffer::indexRest() const
+{
+	if (m_indexed > m_size)
+	{
+		return;
+	}
+	if (m_size - m_indexed < PARALLEL_BYTES)
+	{
+		while (m_indexed <= m_size)
+		{
+			indexBlock();
+		}
+		return;
+	}
+
+	// each chunk indexes the lines that start in it, into blocks of its own
+	size_t first = m_indexed;
+	size_t chunks = (m_size - first + INDEX_CHUNK - 1) / INDEX_CHUNK;
+	vector<vector<Block>> found(chunks);
+	if (!m_pool)
+	{
+		m_pool.reset(new ThreadPool);
+	}
+	m_pool->parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t chunk = begin; chunk < end; ++chunk)
+		{
+			size_t pos = first + chunk * INDEX_CHUNK;
+			size_t stop = min(pos + INDEX_CHUNK, m_size);
+			if (chunk > 0 && m_data[pos - 1] != '\n')
+			{
+				// the line running into this chunk belongs to the one before
+				size_t newline;
+				NewlineScanner scanner(m_data, stop, pos);
+				if (!scanner.next(newline))
+				{
+					continue;
+				}
+				pos = newline + 1;
+			}
+			if (pos < stop)
+			{
+				scanLines(pos, stop, SIZE_MAX, found[chunk]);
+			}
+		}
+	});
+
+	// chunks end in part-filled blocks, which is fine: blocks only need to be at most MAX_BLOCK_LINES
+	for (size_t chunk = 0; chunk < chunks; ++chunk)
+	{
+		appendBlocks(found[chunk]);
+	}
+	m_indexed = m_size + 1;
+}
+
+size_t TextBuffer::scanLines(size_t pos, size_t stop, size_t maxLines, std::vector<Block> &blocks) const
+{
+	// O(bytes): one pass finds the newlines and drops the '\r' of a CRLF as it goes; there is always
+	// at least one line, even from an empty range
+	NewlineScanner scanner(m_data, m_size, pos);
+	size_t lines = 0;
+	do
+	{
+		size_t newline;
+		size_t end = scanner.next(newline) ? newline : m_size;
+		size_t length = end - pos;
+		if (length > 0 && m_data[end - 1] == '\r')
+		{
+			--length;
+		}
+
+		if (blocks.empty() || blocks.back().lines.size() == LOAD_BLOCK_LINES)
+		{
+			blocks.emplace_back();
+			blocks.back().lines.reserve(LOAD_BLOCK_LINES);
+		}
+		blocks.back().lines.push_back(Line{m_data + pos, static_cast<uint32_t>(length), -1});
+		pos = end + 1;
+		++lines;
+	} while (pos < stop && lines < maxLines);
+	return pos;
+}
+
+void TextBuffer::appendBlocks(std::vector<Block> &blocks) const
+{
+	// O(log blocks) each: a new node covers itself plus the nodes below it that it spans
+	for (Block &block : blocks)
+	{
+		int size = block.lines.size();
+		m_blocks.push_back(std::move(block));
+		int node = m_blocks.size();
+		int sum = size;
+		for (int child = node - 1; child > node - (node & -node); child -= child & -child)
+		{
+			sum += m_tree[child];
+		}
+		m_tree.push_back(sum);
+		m_lineCount += size;
+	}
+}
@@ -0,0 +1,224 @@
+#ifndef TEXTBUFFER_H_
+#define TEXTBUFFER_H_
+
+#include "GapBuffer.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The lines of a document, kept in blocks of at most MAX_BLOCK_LINES with a Fenwick tree over the
+// block sizes: finding a row is O(log blocks), and adding or removing a line only shifts the lines
+// of its own block. Each line is a view, either into the text the document was loaded from (which
+// is never written to) or into a string of its own, made the first time the line is edited. A file
+// is memory-mapped rather than read, and its lines are indexed a block at a time as rows past the
+// last indexed one are asked for, so loading costs the same for any size and only pages that are
+// looked at are read; indexing the whole of a large file is split across threads. Lookups near the
+// previous one (the cursor moving, a redraw around it) are answered from that block directly. The
+// owned line edited last is kept in a gap buffer, so typing or deleting at one spot in even a very
+// long line costs O(1) a character rather than moving the rest of the line; reading the line out in
+// one piece closes the gap. Owned lines are allocated from a pool of the buffer's own, which is
+// released as a whole when new contents replace them, rather than each going to and from the heap.
+// There is always at least one line.
+//
+// The mapped file must not be changed in place while it is loaded; save by writing a new file and
+// renaming it over the old one.
+class TextBuffer
+{
+public:
+	TextBuffer();
+
+	// replace the contents with text split at '\n'; a '\r' before a '\n' is dropped
+	void assign(std::string text);
+	bool load(const std::string &path);
+	void clear();
+
+	// indexes the rest of the document, O(N) the first time
+	int lineCount() const;
+	// indexes only as far as row
+	bool hasLine(int row) const { return row < m_lineCount || indexThrough(row); }
+	std::string_view line(int row) const;
+	// none of these closes the gap in the line being edited
+	int lineLength(int row) const;
+	char at(int row, int col) const;
+	std::string substr(int row, int col, int count) const;
+
+	// text must not contain '\n'
+	void insert(int row, int col, std::string_view text);
+	void erase(int row, int col, int count);
+	// break row at col; the rest of it becomes row + 1
+	void split(int row, int col);
+	// append row + 1 to row
+	void join(int row);
+
+	// fn(std::string_view) for each of rows [first, last), in order
+	template <typename Fn>
+	void forEachLine(int first, int last, Fn fn) const;
+	// fn(int row, std::string_view) for each of rows [first, last), or to the end if last < 0, until it
+	// returns true; that row, or -1. Indexes only as far as it gets
+	template <typename Fn>
+	int findLine(int first, int last, Fn fn) const;
+	// fn(std::string_view) over the whole document as text, each line ending in '\n'. Runs of
+	// unedited lines that were '\n'-terminated in the loaded text come as one piece of it
+	template <typename Fn>
+	void forEachSpan(Fn fn) const;
+	// whether text lies within the loaded text, which stays put until the next assign, load or clear
+	bool inLoadedText(std::string_view text) const;
+	// all of it, as it was read, '\r's and all
+	std::string_view loadedText() const { return std::string_view(m_data, m_size); }
+
+private:
+	static const int MAX_BLOCK_LINES = 1024;
+	static const int LOAD_BLOCK_LINES = MAX_BLOCK_LINES / 2; // leaves room to insert after loading
+	// indexing the rest of a document this big is done in parallel, in chunks of INDEX_CHUNK bytes
+	static const size_t PARALLEL_BYTES = 16 << 20;
+	static const size_t INDEX_CHUNK = 4 << 20;
+
+	struct Line
+	{
+		const char *data; // into m_data, unless owned
+		uint32_t size;
+		int32_t owned; // index into m_owned, or -1
+	};
+
+	struct Block
+	{
+		std::vector<Line> lines;
+	};
+
+	MappedFile m_file;
+	std::string m_text; // read instead when the file can't be mapped
+	const char *m_data; // the loaded text that unedited lines point into: m_file or m_text
+	size_t m_size;
+	// for m_owned and m_gap, so declared before them; small chunks keep what a pool holds on to
+	// close to what it uses
+	std::pmr::unsynchronized_pool_resource m_linePool;
+	std::vector<std::pmr::string> m_owned;
+	std::vector<int> m_freeOwned;
+	mutable GapBuffer m_gap; // holds m_owned[m_gapOwned] while it is being edited, or -1
+	int m_gapOwned;
+	// the index grows as const lookups reach past its end
+	mutable std::vector<Block> m_blocks;
+	mutable std::vector<int> m_tree; // 1-based Fenwick tree of block sizes
+	mutable int m_lineCount;
+	mutable size_t m_indexed; // where the first line not yet indexed starts, or past m_size when done
+	mutable std::unique_ptr<ThreadPool> m_pool; // started by the first document big enough to split up
+	mutable int m_fingerBlock; // the block the last lookup landed in, and its first row
+	mutable int m_fingerStart;
+
+	std::string_view view(const Line &line) const;
+	void locate(int row, int &block, int &index) const;
+	Line &lineAt(int row);
+	std::pmr::string &own(Line &line);
+	GapBuffer &edit(Line &line);
+	void settle();
+	void release(Line &line);
+	void insertLine(int row, const Line &line);
+	void eraseLine(int row);
+	void resized(int block, int delta);
+	void rebuildIndex();
+	void startIndex();
+	bool indexThrough(int row) const;
+	void indexBlock() const;
+	void indexRest() const;
+	size_t scanLines(size_t pos, size_t stop, size_t maxLines, std::vector<Block> &blocks) const;
+	void appendBlocks(std::vector<Block> &blocks) const;
+};
+
+template <typename Fn>
+void TextBuffer::forEachLine(int first, int last, Fn fn) const
+{
+	// one lookup, then walk the blocks
+	if (first >= last || !hasLine(last - 1))
+	{
+		return;
+	}
+	int block, index;
+	locate(first, block, index);
+	for (int row = first; row < last; ++row)
+	{
+		while (index == m_blocks[block].lines.size())
+		{
+			++block;
+			index = 0;
+		}
+		fn(view(m_blocks[block].lines[index++]));
+	}
+}
+
+template <typename Fn>
+int TextBuffer::findLine(int first, int last, Fn fn) const
+{
+	// one lookup, then walk the blocks, indexing another each time the walk reaches the end
+	if (!hasLine(first))
+	{
+		return -1;
+	}
+	int block, index;
+	locate(first, block, index);
+	for (int row = first; row != last; ++row)
+	{
+		while (index == m_blocks[block].lines.size())
+		{
+			if (block + 1 == m_blocks.size() && !hasLine(row))
+			{
+				return -1;
+			}
+			++block;
+			index = 0;
+		}
+		if (fn(row, view(m_blocks[block].lines[index++])))
+		{
+			return row;
+		}
+	}
+	return -1;
+}
+
+template <typename Fn>
+void TextBuffer::forEachSpan(Fn fn) const
+{
+	// O(lines) to walk, but a file saved without edits is passed on as a single span
+	indexRest();
+	const char *runStart = nullptr;
+	const char *runEnd = nullptr;
+	for (const Block &block : m_blocks)
+	{
+		for (const Line &line : block.lines)
+		{
+			bool inText = line.owned < 0 && line.data + line.size < m_data + m_size && line.data[line.size] == '\n';
+			if (inText && line.data == runEnd)
+			{
+				runEnd += line.size + 1;
+				continue;
+			}
+			if (runStart != runEnd)
+			{
+				fn(std::string_view(runStart, runEnd - runStart));
+			}
+			if (inText)
+			{
+				runStart = line.data;
+				runEnd = line.data + line.size + 1;
+			}
+			else
+			{
+				fn(view(line));
+				fn(std::string_view("\n", 1));
+				runStart = runEnd = nullptr;
+			}
+		}
+	}
+	if (runStart != runEnd)
+	{
+		fn(std::string_view(runStart, runEnd - runStart));
+	}
+}
+
+#endif // TEXTBUFFER_H_
@@ -1,6 +1,7 @@
 #ifndef TEXTEDITOR_H_
 #define TEXTEDITOR_H_
 
+#include "TextSearch.h"
 #include <string>
 #include <vector>
 
@@ -22,9 +23,108 @@ public:
 	virtual void del() = 0;
 	virtual void backspace() = 0;
 	virtual void move(Dir dir) = 0;
+	// Put the cursor on row (clamped to the document) at col (clamped to the line). This default
+	// steps there with move(); editors that can seek directly override it.
+	virtual void moveTo(int row, int col) {
+		int r, c;
+		getPos(r, c);
+		while (r != row) {
+			int from = r;
+			move(r < row ? DOWN : UP);
+			getPos(r, c);
+			if (r == from) break;  // top or bottom of the document
+		}
+		row = r;
+		if (col < 0) col = 0;
+		while (c != col) {
+			int from = c;
+			move(c < col ? RIGHT : LEFT);
+			getPos(r, c);
+			if (r != row) {  // went past the end of the line
+				move(LEFT);
+				break;
+			}
+			if (c == from) break;
+		}
+	}
 	virtual void getPos(int& row, int& col) const = 0;
 	virtual int getLines(int startRow, int numRows, std::vector<std::string>& lines) const = 0;
 	virtual void undo() = 0;
+	// Make again what undo() last took back. This default does nothing; editors whose undo keeps what
+	// it takes back override it.
+	virtual void redo() { }
+
+	// Replace count chars of row, starting at col, with text. Neither the chars nor text may span a
+	// line break.
+	struct Edit {
+		int row;
+		int col;
+		int count;
+		std::string text;
+	};
+	// Make edits, sorted by position and not overlapping, all at once; the cursor keeps its row and
+	// col (clamped). False, with nothing changed, if they aren't sorted or don't fit the document.
+	// This default makes them one at a time, last first, with moveTo(), del() and insert(); editors
+	// that can apply them in one pass, as a single undo step, override it.
+	virtual bool applyEdits(const std::vector<Edit>& edits) {
+		std::vector<std::string> line;
+		for (size_t i = 0; i < edits.size(); i++) {
+			const Edit& e = edits[i];
+			if (e.row < 0 || e.col < 0 || e.count < 0 || getLines(e.row, 1, line) != 1 ||
+				e.col + e.count > (int)line[0].size() || e.text.find('\n') != std::string::npos)
+				return false;
+			if (i > 0 && (e.row < edits[i - 1].row ||
+				(e.row == edits[i - 1].row && e.col < edits[i - 1].col + edits[i - 1].count)))
+				return false;
+		}
+		int row, col;
+		getPos(row, col);
+		for (size_t i = edits.size(); i-- > 0; ) {
+			moveTo(edits[i].row, edits[i].col);
+			for (int n = 0; n < edits[i].count; n++)
+				del();
+			for (char ch : edits[i].text)
+				insert(ch);
+		}
+		moveTo(row, col);
+		return true;
+	}
+
+	// Put the cursor on the start of the next match of search after it, going round from the top of
+	// the document if need be; length gets the length of the match. False, with the cursor where it
+	// was, if there is none. This default reads the whole document through getLines().
+	virtual bool find(const TextSearch& search, int& length) {
+		int row, col;
+		getPos(row, col);
+		std::vector<std::string> lines;
+		getLines(0, 1 << 30, lines);
+		for (size_t i = 0; i <= lines.size() && !lines.empty(); i++) {
+			int r = (row + i) % lines.size();
+			size_t start, found;
+			if (search.find(lines[r], i == 0 ? col + 1 : 0, start, found) && (i < lines.size() || (int)start <= col)) {
+				moveTo(r, start);
+				length = found;
+				return true;
+			}
+		}
+		return false;
+	}
+	// Replace every match of search with replacement (which must not contain '\n') by applyEdits(), so
+	// as one undo step. Returns how many were replaced.
+	virtual int replaceAll(const TextSearch& search, const std::string& replacement) {
+		std::vector<std::string> lines;
+		getLines(0, 1 << 30, lines);
+		std::vector<Edit> edits;
+		for (size_t r = 0; r < lines.size(); r++) {
+			size_t start, length;
+			for (size_t from = 0; search.find(lines[r], from, start, length); from = start + length)
+				edits.push_back(Edit{ (int)r, (int)start, (int)length, replacement });
+		}
+		return !edits.empty() && applyEdits(edits) ? edits.size() : 0;
+	}
+
+	// Whether the last load() recovered changes that an earlier session made but never saved.
+	virtual bool recovered() const { return false; }
 
 protected:
 	Undo* getUndo() { return undo_; }
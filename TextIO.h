@@ -9,11 +9,17 @@
 
 #include <string>
 
+const int CTRL_B = 'B' - 'A' + 1;
 const int CTRL_D = 'D' - 'A' + 1;
+const int CTRL_F = 'F' - 'A' + 1;
+const int CTRL_R = 'R' - 'A' + 1;
 const int CTRL_S = 'S' - 'A' + 1;
+const int CTRL_T = 'T' - 'A' + 1;
 const int CTRL_L = 'L' - 'A' + 1;
 const int CTRL_X = 'X' - 'A' + 1;
+const int CTRL_Y = 'Y' - 'A' + 1;
 const int CTRL_Z = 'Z' - 'A' + 1;
+const int KEY_ESCAPE = 27;
 
 class TextIO {
 public:
@@ -25,6 +31,7 @@ public:
 		raw();
 		init_pair(COLOR::WHITE, fgcolor, bgcolor);
 		init_pair(COLOR::RED, hilite, bgcolor);
+		init_pair(COLOR::MATCH, bgcolor, fgcolor);
 		keypad(stdscr, TRUE);
 		refresh();
 	}
@@ -40,7 +47,8 @@ public:
 
 	enum COLOR {
 		WHITE = 1,
-		RED = 2
+		RED = 2,
+		MATCH = 3	// search matches, in reverse video
 	};
 
 	static void print(char ch, COLOR fcolor = COLOR::WHITE) {
@@ -0,0 +1,119 @@
+#include "TextSearch.h"
+#include <algorithm>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+TextSearch::TextSearch()
+	: m_regex(false)
+{
+}
+
+bool TextSearch::compile(std::string_view pattern, bool regex)
+{
+	m_pattern.clear();
+	m_regex = regex;
+	if (pattern.empty())
+	{
+		return false;
+	}
+
+	if (regex)
+	{
+		try
+		{
+			m_compiled.assign(pattern.data(), pattern.size(), std::regex::ECMAScript | std::regex::optimize);
+		}
+		catch (const regex_error &)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// O(pattern): a byte found in the pattern before its end moves it on only far enough to line up
+		// the last place the byte occurs; any other byte moves it its whole length
+		size_t last = pattern.size() - 1;
+		for (size_t &skip : m_skip)
+		{
+			skip = pattern.size();
+		}
+		for (size_t i = 0; i < last; ++i)
+		{
+			m_skip[static_cast<unsigned char>(pattern[i])] = last - i;
+		}
+	}
+	m_pattern = pattern;
+	return true;
+}
+
+bool TextSearch::find(std::string_view line, size_t from, size_t &start, size_t &length) const
+{
+	if (m_pattern.empty() || from > line.size())
+	{
+		return false;
+	}
+
+	if (m_regex)
+	{
+		// a search per window, each passing over empty matches, as they can't be shown or replaced
+		// usefully; only the last window ends where the line does, so $ or \b can match there
+		size_t window = max<size_t>(BACKTRACK_BUDGET / m_pattern.size(), 2);
+		for (size_t pos = from;; pos += window / 2)
+		{
+			size_t stop = min(line.size(), pos + window);
+			bool last = stop == line.size();
+			auto flags = regex_constants::match_not_null | (pos > 0 ? regex_constants::match_prev_avail : regex_constants::match_default) |
+				(last ? regex_constants::match_default : regex_constants::match_not_eol | regex_constants::match_not_eow);
+			cmatch match;
+			if (regex_search(line.data() + pos, line.data() + stop, match, m_compiled, flags) &&
+				(last || static_cast<size_t>(match.position(0)) < window / 2))
+			{
+				start = match.position(0) + pos;
+				length = match.length(0);
+				return true;
+			}
+			if (last)
+			{
+				return false;
+			}
+		}
+	}
+
+	size_t size = m_pattern.size();
+	if (line.size() - from < size)
+	{
+		return false;
+	}
+	const char *text = line.data();
+	if (size == 1)
+	{
+		const void *found = memchr(text + from, m_pattern[0], line.size() - from);
+		if (!found)
+		{
+			return false;
+		}
+		start = static_cast<const char *>(found) - text;
+		length = 1;
+		return true;
+	}
+
+	// O(line / pattern) at best, comparing the rest only when the last byte matches
+	size_t last = size - 1;
+	char lastChar = m_pattern[last];
+	for (size_t pos = from; pos + size <= line.size();)
+	{
+		char ch = text[pos + last];
+		if (ch == lastChar && memcmp(text + pos, m_pattern.data(), last) == 0)
+		{
+			start = pos;
+			length = size;
+			return true;
+		}
+		pos += m_skip[static_cast<unsigned char>(ch)];
+	}
+	return false;
+}
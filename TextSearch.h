@@ -0,0 +1,44 @@
+#ifndef TEXTSEARCH_H_
+#define TEXTSEARCH_H_
+
+#include <cstddef>
+#include <regex>
+#include <string>
+#include <string_view>
+
+// A pattern to find in the lines of a document, either literal text or an ECMAScript regex. Literal
+// text is found with a Boyer-Moore-Horspool skip table, which jumps up to the pattern's length at a
+// time, so a long or rare word is found without looking at most of the text; a single character is
+// left to memchr. Matches never span lines and are never empty.
+//
+// std::regex backtracks by recursing once or more per character it looks at, so given a whole long
+// line it runs out of stack. It is only ever given a window of the line short enough for the pattern;
+// on a longer line the windows overlap by half, each starting where the last one's second half does,
+// and a match is taken from the first window that has one starting in its first half. So a match
+// no longer than half a window is found just as on a short line, and a longer one is cut short at the
+// end of its window.
+class TextSearch
+{
+public:
+	TextSearch();
+
+	// False, leaving nothing to find, if pattern is empty or isn't a valid regex.
+	bool compile(std::string_view pattern, bool regex);
+	bool valid() const { return !m_pattern.empty(); }
+	const std::string &pattern() const { return m_pattern; }
+	bool regex() const { return m_regex; }
+
+	// Find the first match in line that starts at or after from: its offset and length.
+	bool find(std::string_view line, size_t from, size_t &start, size_t &length) const;
+
+private:
+	std::string m_pattern;
+	bool m_regex;
+	// line length times pattern length that backtracking is trusted with
+	static const size_t BACKTRACK_BUDGET = 1 << 14;
+
+	std::regex m_compiled;
+	size_t m_skip[256]; // how far the pattern may move on when the byte under its end is a mismatch
+};
+
+#endif // TEXTSEARCH_H_
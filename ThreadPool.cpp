@@ -0,0 +1,115 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+ThreadPool::ThreadPool(int threads)
+	: m_stopping(false)
+{
+	if (threads <= 0)
+	{
+		threads = thread::hardware_concurrency();
+	}
+	if (threads <= 0)
+	{
+		threads = 1;
+	}
+
+	for (int i = 0; i < threads; ++i)
+	{
+		m_threads.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	// let the workers drain the queue, then join them
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_ready.notify_all();
+
+	for (auto it = m_threads.begin(); it != m_threads.end(); ++it)
+	{
+		it->join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_ready.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body)
+{
+	grain = max<size_t>(grain, 1);
+	size_t chunks = (count + grain - 1) / grain;
+	if (chunks == 0)
+	{
+		return;
+	}
+
+	// every runner claims chunks from a shared counter until none are left, so slow chunks even out
+	atomic<size_t> next(0);
+	auto run = [&] {
+		for (size_t begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain))
+		{
+			body(begin, min(begin + grain, count));
+		}
+	};
+
+	// the caller is one of the runners, so a single chunk never leaves this thread
+	mutex doneMutex;
+	condition_variable done;
+	int helpers = min<size_t>(chunks - 1, m_threads.size());
+	int running = helpers;
+	for (int i = 0; i < helpers; ++i)
+	{
+		submit([&] {
+			run();
+
+			lock_guard<mutex> lock(doneMutex);
+			if (--running == 0)
+			{
+				done.notify_one();
+			}
+		});
+	}
+	run();
+
+	unique_lock<mutex> lock(doneMutex);
+	done.wait(lock, [&] { return running == 0; });
+}
+
+void ThreadPool::work()
+{
+	for (;;)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_ready.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+
+			// only exit once there's nothing left to do
+			if (m_tasks.empty())
+			{
+				return;
+			}
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+	}
+}
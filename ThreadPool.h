@@ -0,0 +1,41 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads pulling tasks from a shared FIFO queue.
+class ThreadPool
+{
+public:
+	// threads <= 0 means one per hardware thread
+	explicit ThreadPool(int threads = 0);
+	~ThreadPool();
+
+	void submit(std::function<void()> task);
+
+	// Run body(begin, end) over [0, count) in chunks of at most grain items, spread over the workers
+	// and the calling thread, and return once all of them are done. Not to be called from a task.
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+	int size() const { return m_threads.size(); }
+
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_ready;
+	bool m_stopping;
+
+	void work();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+};
+
+#endif // THREADPOOL_H_
@@ -1,6 +1,8 @@
 #ifndef UNDO_H_
 #define UNDO_H_
 
+#include <cstdint>
+#include <functional>
 #include <string>
 
 class Undo {
@@ -17,8 +19,40 @@ public:
 	virtual ~Undo() { }
 
 	virtual void submit(const Action action, int row, int col, char ch = 0) = 0;
+	// The same as submitting each char of text in turn: an INSERT of text starting at col, or a DELETE
+	// of text at col. This default does just that; undos that can take it in one go override it.
+	virtual void submitText(const Action action, int row, int col, const std::string& text) {
+		for (size_t i = 0; i < text.size(); i++)
+			submit(action, row, action == INSERT ? col + i + 1 : col, text[i]);
+	}
 	virtual Action get(int& row, int& col, int& count, std::string& text) = 0;
 	virtual void clear() = 0;
+
+	// Everything submitted between beginGroup() and endGroup() is undone as one step: after get() (or
+	// redo()) hands back part of a group, moreInGroup() says whether the next call continues it.
+	// Groups may nest; the outermost one counts.
+	virtual void beginGroup() { }
+	virtual void endGroup() { }
+	virtual bool moreInGroup() const { return false; }
+
+	// What get() undoes can be redone: redo() hands back the change get() last took back, as it was
+	// first made (INSERT text at col, DELETE count chars at col, SPLIT or JOIN at col), or ERROR if
+	// there is none. A change submitted after an undo starts a new branch beside the undone ones rather
+	// than discarding them; nextBranch() makes redo() take the next of them, going round, and returns
+	// its number, oldest first, with branches() how many there are. Both 0 where there's no choice.
+	virtual Action redo(int& row, int& col, int& count, std::string& text) { return ERROR; }
+	virtual int branches() const { return 0; }
+	virtual int nextBranch() { return 0; }
+
+	// Keep the history in the file at path, tagged with the document as it now stands (just saved): its
+	// size, modification time and a hash of its text, so loadHistory() can bring it back when the
+	// document is opened again unchanged; after the first time only what is new since is added to the
+	// file. loadHistory() replaces the history with the one in path if it was saved with this size and
+	// time. Only then is hash() called, for the document's hash, and only when the history is first
+	// used; if that isn't what it was saved with, what was brought back is dropped again. False if they
+	// couldn't; neither is supported by default.
+	virtual bool saveHistory(const std::string& path, uint64_t size, int64_t mtime, uint64_t hash) { return false; }
+	virtual bool loadHistory(const std::string& path, uint64_t size, int64_t mtime, std::function<uint64_t()> hash) { return false; }
 };
 
 Undo* createUndo();
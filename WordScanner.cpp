@@ -0,0 +1,130 @@
+#include "WordScanner.h"
+#include "ByteClassifier.h"
+
+#ifdef BYTECLASSIFIER_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+	uint64_t classifyScalar(const char *block)
+	{
+		// bit i set if block[i] is a letter or apostrophe
+		uint64_t mask = 0;
+		for (int i = 0; i < 64; ++i)
+		{
+			unsigned char lower = block[i] | 0x20;
+			if ((lower >= 'a' && lower <= 'z') || block[i] == '\'')
+			{
+				mask |= 1ull << i;
+			}
+		}
+		return mask;
+	}
+
+#ifdef BYTECLASSIFIER_X86
+	// A byte is a letter if (byte | 0x20) - 'a' is at most 25 as an unsigned value. SSE2/AVX2 only
+	// compare signed bytes, so the range is shifted down by 128 first: letters land below -102.
+
+	__attribute__((target("sse2"))) uint64_t classifySse2(const char *block)
+	{
+		const __m128i caseBit = _mm_set1_epi8(0x20);
+		const __m128i shift = _mm_set1_epi8(static_cast<char>('a' + 128));
+		const __m128i limit = _mm_set1_epi8(-128 + 26);
+		const __m128i apostrophe = _mm_set1_epi8('\'');
+
+		uint64_t mask = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16 * i));
+			__m128i shifted = _mm_sub_epi8(_mm_or_si128(bytes, caseBit), shift);
+			__m128i word = _mm_or_si128(_mm_cmplt_epi8(shifted, limit), _mm_cmpeq_epi8(bytes, apostrophe));
+			mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(word))) << (16 * i);
+		}
+		return mask;
+	}
+
+	__attribute__((target("avx2"))) uint64_t classifyAvx2(const char *block)
+	{
+		const __m256i caseBit = _mm256_set1_epi8(0x20);
+		const __m256i shift = _mm256_set1_epi8(static_cast<char>('a' + 128));
+		const __m256i limit = _mm256_set1_epi8(-128 + 26);
+		const __m256i apostrophe = _mm256_set1_epi8('\'');
+
+		uint64_t mask = 0;
+		for (int i = 0; i < 2; ++i)
+		{
+			__m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32 * i));
+			__m256i shifted = _mm256_sub_epi8(_mm256_or_si256(bytes, caseBit), shift);
+			__m256i word = _mm256_or_si256(_mm256_cmpgt_epi8(limit, shifted), _mm256_cmpeq_epi8(bytes, apostrophe));
+			mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(word))) << (32 * i);
+		}
+		return mask;
+	}
+#endif
+
+	const ByteClassifier &classifier()
+	{
+#ifdef BYTECLASSIFIER_X86
+		static const ByteClassifier chosen(classifyScalar, classifySse2, classifyAvx2);
+#else
+		static const ByteClassifier chosen(classifyScalar, nullptr, nullptr);
+#endif
+		return chosen;
+	}
+}
+
+WordScanner::WordScanner(const char *data, size_t size)
+	: m_data(data), m_size(size), m_block(0), m_mask(0)
+{
+	loadBlock(0);
+}
+
+const char *WordScanner::implementation()
+{
+	return classifier().name();
+}
+
+bool WordScanner::next(int &start, int &end)
+{
+	// skip to the first word char at or after the scan position
+	while (m_mask == 0)
+	{
+		if (m_block + BLOCK >= m_size)
+		{
+			return false;
+		}
+		loadBlock(m_block + BLOCK);
+	}
+	int first = ByteClassifier::lowestBit(m_mask);
+	start = m_block + first;
+
+	// the word ends just before the next non-word char, possibly several blocks on
+	uint64_t breaks = ~m_mask & (~0ull << first);
+	while (breaks == 0)
+	{
+		if (m_block + BLOCK >= m_size)
+		{
+			end = m_size - 1;
+			m_mask = 0;
+			return true;
+		}
+		loadBlock(m_block + BLOCK);
+		breaks = ~m_mask;
+	}
+	int stop = ByteClassifier::lowestBit(breaks);
+	end = m_block + stop - 1;
+
+	// everything below stop has been consumed
+	m_mask &= ~0ull << stop;
+	return true;
+}
+
+void WordScanner::loadBlock(size_t block)
+{
+	// NULs past the end are never word chars
+	m_block = block;
+	m_mask = classifier().classify(m_data, m_size, block);
+}
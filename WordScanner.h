@@ -0,0 +1,32 @@
+#ifndef WORDSCANNER_H_
+#define WORDSCANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Finds the words (runs of letters and apostrophes) in a line without copying it. Bytes are
+// classified 64 at a time into a bitmask, using AVX2 or SSE2 when the CPU has them (picked once at
+// startup) and a plain loop otherwise; word boundaries then fall out of bit scans over the mask.
+class WordScanner
+{
+public:
+	WordScanner(const char *data, size_t size);
+
+	// Find the next word. start and end (inclusive) are byte offsets into the line.
+	bool next(int &start, int &end);
+
+	// Name of the classifier in use: "avx2", "sse2" or "scalar".
+	static const char *implementation();
+
+private:
+	static const size_t BLOCK = 64;
+
+	const char *m_data;
+	size_t m_size;
+	size_t m_block; // offset of the block m_mask describes
+	uint64_t m_mask; // word-char bits of that block, cleared below the scan position
+
+	void loadBlock(size_t block);
+};
+
+#endif // WORDSCANNER_H_
@@ -0,0 +1,115 @@
+// edit-session: load, page through and edit a large document the way the GUI drives the editor.
+//
+// usage: bench/edit-session [COPIES...]
+//
+// For warandpeace.txt repeated COPIES times (1 and 10 by default), copied to /tmp so the journal
+// doesn't land in the tree, prints the time to load it, to page down through all of it 50 rows at a
+// time, and for a scripted session of 200 jumps between HOME and END, each followed by moves,
+// typing, Enter, backspaces and undos, with a 50-row redraw around the cursor after every key.
+#include "TextEditor.h"
+#include "Undo.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	double msSince(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	vector<int> copies;
+	for (int i = 1; i < argc; ++i)
+	{
+		copies.push_back(atoi(argv[i]));
+	}
+	if (copies.empty())
+	{
+		copies = {1, 10};
+	}
+	stringstream book;
+	book << ifstream("warandpeace.txt").rdbuf();
+	string path = "/tmp/wurd-edit-session-" + to_string(getpid()) + ".txt";
+
+	for (int count : copies)
+	{
+		{
+			ofstream out(path, ios::binary);
+			for (int i = 0; i < count; ++i)
+			{
+				out << book.str();
+			}
+		}
+		Undo *undo = createUndo();
+		TextEditor *editor = createTextEditor(undo);
+		vector<string> lines;
+		int row, col;
+
+		auto start = chrono::steady_clock::now();
+		editor->load(path);
+		double load = msSince(start);
+
+		start = chrono::steady_clock::now();
+		int top = 0;
+		while (editor->getLines(top, 50, lines) == 50)
+		{
+			for (int i = 0; i < 50; ++i)
+			{
+				editor->move(TextEditor::DOWN);
+			}
+			top += 50;
+		}
+		double page = msSince(start);
+
+		auto redraw = [&]() {
+			editor->getPos(row, col);
+			editor->getLines(row > 25 ? row - 25 : 0, 50, lines);
+		};
+		start = chrono::steady_clock::now();
+		for (int jump = 0; jump < 200; ++jump)
+		{
+			editor->move(jump % 2 ? TextEditor::END : TextEditor::HOME);
+			redraw();
+			for (int i = 0; i < 20; ++i)
+			{
+				editor->move(jump % 2 ? TextEditor::UP : TextEditor::DOWN);
+				redraw();
+			}
+			for (const char *ch = "hello wurd"; *ch; ++ch)
+			{
+				editor->insert(*ch);
+				redraw();
+			}
+			editor->enter();
+			redraw();
+			for (int i = 0; i < 3; ++i)
+			{
+				editor->backspace();
+				redraw();
+			}
+			editor->undo();
+			redraw();
+			editor->undo();
+			redraw();
+		}
+		double edit = msSince(start);
+
+		printf("%2dx warandpeace.txt (%.0f MB): load %.1f ms, page-down %.1f ms (%d rows), edit session %.1f ms\n",
+			count, count * book.str().size() / 1e6, load, page, top, edit);
+		delete editor;
+		delete undo;
+	}
+	unlink(path.c_str());
+	return 0;
+}
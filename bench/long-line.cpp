@@ -0,0 +1,84 @@
+// long-line: typing and deleting in the middle of one very long line.
+//
+// usage: bench/long-line [MEGABYTES [KEYS]]
+//
+// Loads a single line of MEGABYTES (10 by default) from /tmp, puts the cursor in the middle of it,
+// and times KEYS (100000 by default) typed characters, then as many backspaces, then one key followed
+// by a redraw of the line, as the GUI does after every key. The same typing and backspacing is then
+// timed on a TextBuffer alone, without the editor's undo and journal.
+#include "TextBuffer.h"
+#include "TextEditor.h"
+#include "Undo.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	double msSince(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	size_t size = (argc > 1 ? atoi(argv[1]) : 10) << 20;
+	int keys = argc > 2 ? atoi(argv[2]) : 100000;
+	string path = "/tmp/wurd-long-line-" + to_string(getpid()) + ".txt";
+	string line(size, 'x');
+	ofstream(path, ios::binary) << line << '\n';
+	int middle = size / 2;
+
+	Undo *undo = createUndo();
+	TextEditor *editor = createTextEditor(undo);
+	editor->load(path);
+	editor->moveTo(0, middle);
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < keys; ++i)
+	{
+		editor->insert('a' + i % 26);
+	}
+	double typed = msSince(start);
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < keys; ++i)
+	{
+		editor->backspace();
+	}
+	double erased = msSince(start);
+	vector<string> lines;
+	start = chrono::steady_clock::now();
+	editor->insert('a');
+	editor->getLines(0, 1, lines);
+	double redraw = msSince(start);
+	delete editor;
+	delete undo;
+	unlink(path.c_str());
+
+	TextBuffer buffer;
+	buffer.assign(line);
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < keys; ++i)
+	{
+		char ch = 'a' + i % 26;
+		buffer.insert(0, middle + i, string_view(&ch, 1));
+	}
+	double bufferTyped = msSince(start);
+	start = chrono::steady_clock::now();
+	for (int i = keys; i-- > 0;)
+	{
+		buffer.erase(0, middle + i, 1);
+	}
+	double bufferErased = msSince(start);
+
+	printf("%zu MB line, %d keys at column %d\n", size >> 20, keys, middle);
+	printf("  editor:      type %.1f ms, backspace %.1f ms, key + redraw %.2f ms\n", typed, erased, redraw);
+	printf("  buffer only: type %.1f ms, backspace %.1f ms\n", bufferTyped, bufferErased);
+	return 0;
+}
@@ -0,0 +1,92 @@
+// range-edit: pasting and cutting a large block in a long line, and undoing and redoing it.
+//
+// usage: bench/range-edit [KILOBYTES]
+//
+// Puts a 1 MB line in a fresh editor and, in the middle of it, times one applyEdits() that pastes
+// KILOBYTES (50 by default) and one that cuts as much, with the undo and redo of each; then the same
+// amount typed a key at a time and deleted a key at a time, with the undo of each. Every undo must
+// give back the original line.
+#include "TextEditor.h"
+#include "Undo.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const int LINE = 1 << 20;
+
+	double msSince(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+
+	TextEditor *freshEditor(Undo *undo)
+	{
+		TextEditor *editor = createTextEditor(undo);
+		editor->reset();
+		editor->applyEdits({ { 0, 0, 0, string(LINE, 'a') } });
+		editor->moveTo(0, LINE / 2);
+		return editor;
+	}
+
+	bool original(TextEditor *editor)
+	{
+		vector<string> lines;
+		editor->getLines(0, 2, lines);
+		return lines.size() == 1 && lines[0] == string(LINE, 'a');
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int amount = (argc > 1 ? atoi(argv[1]) : 50) * 1000;
+	bool ok = true;
+	printf("1 MB line, %d bytes at column %d\n", amount, LINE / 2);
+	for (int kind = 0; kind < 4; ++kind)
+	{
+		static const char *const names[] = { "paste", "cut", "type", "delete" };
+		Undo *undo = createUndo();
+		TextEditor *editor = freshEditor(undo);
+		auto start = chrono::steady_clock::now();
+		if (kind == 0)
+		{
+			editor->applyEdits({ { 0, LINE / 2, 0, string(amount, 'p') } });
+		}
+		else if (kind == 1)
+		{
+			editor->applyEdits({ { 0, LINE / 2, amount, "" } });
+		}
+		else
+		{
+			for (int i = 0; i < amount; ++i)
+			{
+				kind == 2 ? editor->insert('t') : editor->del();
+			}
+		}
+		double edited = msSince(start);
+		start = chrono::steady_clock::now();
+		editor->undo();
+		double undone = msSince(start);
+		ok = original(editor) && ok;
+		printf("  %-7s edit %8.2f ms, undo %8.2f ms", names[kind], edited, undone);
+		if (kind < 2)
+		{
+			start = chrono::steady_clock::now();
+			editor->redo();
+			printf(", redo %8.2f ms", msSince(start));
+		}
+		printf("\n");
+		delete editor;
+		delete undo;
+	}
+	if (!ok)
+	{
+		printf("FAILED: an undo did not give back the original line\n");
+	}
+	return ok ? 0 : 1;
+}
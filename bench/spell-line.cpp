@@ -0,0 +1,55 @@
+// spell-line: spellCheckLine throughput over the sample texts.
+//
+// Checks every line of each text as a string_view, best of 7 runs, and prints MB/s along with the
+// word scanner in use (WURD_SIMD=scalar or sse2 to compare).
+#include "StudentSpellCheck.h"
+#include "WordScanner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+	StudentSpellCheck checker;
+	if (!checker.load("dictionary.txt"))
+	{
+		printf("can't load dictionary.txt\n");
+		return 1;
+	}
+	printf("word scanner: %s\n", WordScanner::implementation());
+	for (const char *file : {"threemen.txt", "warandpeace.txt"})
+	{
+		ifstream in(file);
+		vector<string> lines;
+		size_t bytes = 0;
+		string line;
+		while (getline(in, line))
+		{
+			bytes += line.size() + 1;
+			lines.push_back(line);
+		}
+
+		vector<SpellCheck::Position> problems;
+		double best = 1e30;
+		size_t found = 0;
+		for (int run = 0; run < 7; ++run)
+		{
+			found = 0;
+			auto start = chrono::steady_clock::now();
+			for (const string &text : lines)
+			{
+				checker.spellCheckLine(string_view(text), problems);
+				found += problems.size();
+			}
+			best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		}
+		printf("%-16s %8.2f MB  %7zu misspelled  %7.1f MB/s\n", file, bytes / 1e6, found, bytes / 1e6 / best);
+	}
+	return 0;
+}
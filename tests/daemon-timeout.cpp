@@ -0,0 +1,168 @@
+// daemon-timeout: a wurdd that stops answering costs a session a moment, not the session.
+//
+// A stand-in daemon listens on a private socket named by $WURDD_SOCKET. The first one never accepts,
+// so the HELLO goes unanswered and the load must fall back to the dictionary in-process. The second
+// answers the HELLO for dictionary.txt and then reads requests without ever answering them, so the
+// first line checked must time out and be checked locally. Each must come back within a few
+// timeouts, with the same problems as a checker that never tried the daemon.
+#include "DaemonSpellCheck.h"
+#include "DictImage.h"
+#include "SpellProtocol.h"
+#include "StudentSpellCheck.h"
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	int listenOn(const string &path)
+	{
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		memcpy(address.sun_path, path.c_str(), path.size() + 1);
+		unlink(path.c_str());
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, 4) != 0)
+		{
+			return -1;
+		}
+		return fd;
+	}
+
+	bool readFully(int fd, void *data, size_t size)
+	{
+		char *at = static_cast<char *>(data);
+		while (size > 0)
+		{
+			ssize_t n = recv(fd, at, size, 0);
+			if (n <= 0)
+			{
+				return false;
+			}
+			at += n;
+			size -= n;
+		}
+		return true;
+	}
+
+	// answers the HELLO truthfully, then swallows everything else until the client hangs up
+	void stallAfterHello(int listenFd, const string &dictPath, DictStamp stamp)
+	{
+		int fd = accept(listenFd, nullptr, nullptr);
+		SpellRequestHeader header;
+		if (fd >= 0 && readFully(fd, &header, sizeof(header)))
+		{
+			string out;
+			size_t start = beginSpellResponse(out, header.id, SPELL_OK);
+			encodeHello(out, stamp.size, stamp.mtime, dictPath);
+			endSpellResponse(out, start);
+			send(fd, out.data(), out.size(), 0);
+			char discard[4096];
+			while (recv(fd, discard, sizeof(discard), 0) > 0)
+			{
+			}
+		}
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+	}
+
+	bool same(const vector<SpellCheck::Position> &a, const vector<SpellCheck::Position> &b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].start != b[i].start || a[i].end != b[i].end)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	double secondsSince(chrono::steady_clock::time_point start)
+	{
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main()
+{
+	char dictPath[PATH_MAX];
+	DictStamp stamp;
+	StudentSpellCheck reference;
+	if (realpath("dictionary.txt", dictPath) == nullptr || !statDictSource(dictPath, stamp) || !reference.load(dictPath))
+	{
+		printf("can't load dictionary.txt\n");
+		return 1;
+	}
+	string line = "teh quick brwn fox jumps over the lazy dog";
+	vector<SpellCheck::Position> expected;
+	reference.spellCheckLine(line, expected);
+
+	string dir = "/tmp/wurd-daemon-timeout-" + to_string(getpid());
+	string path = dir + "/wurdd.sock";
+	if (!makePrivateDir(dir))
+	{
+		printf("can't make %s\n", dir.c_str());
+		return 1;
+	}
+	setenv("WURDD_SOCKET", path.c_str(), 1);
+	signal(SIGPIPE, SIG_IGN); // for the stand-in; MSG_NOSIGNAL isn't everywhere
+	double limit = 3.0 * SPELL_TIMEOUT_MS / 1000;
+
+	int bad = 0;
+	{
+		// never accepted: the connection waits in the backlog and the HELLO is never read
+		int listenFd = listenOn(path);
+		DaemonSpellCheck checker;
+		vector<SpellCheck::Position> problems;
+		auto start = chrono::steady_clock::now();
+		bool loaded = checker.load("dictionary.txt");
+		double elapsed = secondsSince(start);
+		checker.spellCheckLine(line, problems);
+		if (listenFd < 0 || !loaded || elapsed > limit || !same(problems, expected))
+		{
+			printf("unanswered HELLO: loaded %d after %.2fs\n", loaded, elapsed);
+			++bad;
+		}
+		close(listenFd);
+	}
+	{
+		int listenFd = listenOn(path);
+		thread daemon(stallAfterHello, listenFd, string(dictPath), stamp);
+		DaemonSpellCheck checker;
+		vector<SpellCheck::Position> problems;
+		bool loaded = checker.load("dictionary.txt");
+		auto start = chrono::steady_clock::now();
+		checker.spellCheckLine(line, problems);
+		double elapsed = secondsSince(start);
+		if (listenFd < 0 || !loaded || elapsed > limit || !same(problems, expected))
+		{
+			printf("unanswered line: loaded %d, checked after %.2fs\n", loaded, elapsed);
+			++bad;
+		}
+		daemon.join();
+		close(listenFd);
+	}
+	unlink(path.c_str());
+	rmdir(dir.c_str());
+	printf("%s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+// gap-buffer: GapBuffer against a std::string.
+//
+// Runs of inserts and erases at a cursor that mostly creeps along and sometimes jumps, so the gap
+// both stays put and moves both ways, with reads through the gap (at, substr, size) after each and
+// the whole text compared every so often. Also checks that assign() and take() hand the text over
+// whole. Fails on any difference.
+#include "GapBuffer.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+int main()
+{
+	mt19937 random(17);
+	int bad = 0;
+	for (int run = 0; run < 20 && bad == 0; ++run)
+	{
+		string model(random() % 2000, 'x');
+		for (char &ch : model)
+		{
+			ch = 'a' + random() % 26;
+		}
+		GapBuffer buffer;
+		buffer.assign(std::pmr::string(model));
+
+		size_t cursor = model.size() / 2;
+		for (int op = 0; op < 20000 && bad == 0; ++op)
+		{
+			int kind = random() % 100;
+			if (kind < 5)
+			{
+				cursor = random() % (model.size() + 1);
+			}
+			else if (kind < 15)
+			{
+				cursor = min(model.size(), cursor + random() % 3);
+			}
+			else if (kind < 55)
+			{
+				string text(1 + random() % (kind < 50 ? 2 : 200), 'A' + random() % 26);
+				buffer.insert(cursor, text);
+				model.insert(cursor, text);
+				cursor += text.size();
+			}
+			else if (kind < 80)
+			{
+				// backspace
+				if (cursor > 0)
+				{
+					size_t count = 1 + random() % min<size_t>(cursor, 3);
+					cursor -= count;
+					buffer.erase(cursor, count);
+					model.erase(cursor, count);
+				}
+			}
+			else if (kind < 95)
+			{
+				// delete
+				if (cursor < model.size())
+				{
+					size_t count = 1 + random() % min<size_t>(model.size() - cursor, 3);
+					buffer.erase(cursor, count);
+					model.erase(cursor, count);
+				}
+			}
+			else
+			{
+				if (buffer.text() != model)
+				{
+					printf("text: run %d op %d\n", run, op);
+					++bad;
+				}
+			}
+
+			size_t pos = model.empty() ? 0 : random() % model.size();
+			size_t count = random() % (min<size_t>(model.size() - pos, 100) + 1);
+			if (buffer.size() != model.size() || (!model.empty() && buffer.at(pos) != model[pos]) ||
+				buffer.substr(pos, count) != model.substr(pos, count))
+			{
+				printf("read: run %d op %d\n", run, op);
+				++bad;
+			}
+		}
+		if (std::pmr::string(buffer.take()) != std::pmr::string(model) || buffer.size() != 0)
+		{
+			printf("take: run %d\n", run);
+			++bad;
+		}
+	}
+	printf("%s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+// journal-recovery: an editor killed mid-session is recovered from its journal on the next load.
+//
+// A child process loads a copy of a small file and makes a seeded stream of random edits, moves and
+// undos, counting them in memory shared with the parent, which SIGKILLs it. Some runs let the child
+// stop at a given count and wait long enough for the journal to be written, and those must recover
+// every edit up to it; the others kill it at a random moment, and must recover some prefix of what it
+// had done. The long runs go past the first snapshot. A reference editor in the parent makes the
+// same stream of edits to check against. Two more long runs change the file, keeping its size, after
+// the kill; those must load the changed file, recovering nothing. Fails on any other outcome.
+#include "TextEditor.h"
+#include "Undo.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	void step(TextEditor *editor, mt19937 &random)
+	{
+		int kind = random() % 100;
+		if (kind < 40)
+		{
+			editor->insert("abc xyz\t"[random() % 8]);
+		}
+		else if (kind < 48)
+		{
+			editor->enter();
+		}
+		else if (kind < 55)
+		{
+			editor->del();
+		}
+		else if (kind < 63)
+		{
+			editor->backspace();
+		}
+		else if (kind < 85)
+		{
+			editor->move(static_cast<TextEditor::Dir>(random() % 4));
+		}
+		else if (kind < 93)
+		{
+			int row = random() % 300;
+			editor->moveTo(row, random() % 40);
+		}
+		else
+		{
+			editor->undo();
+		}
+	}
+
+	string text(const TextEditor *editor)
+	{
+		vector<string> lines;
+		editor->getLines(0, 1 << 30, lines);
+		string all;
+		for (const string &line : lines)
+		{
+			all += line;
+			all += '\n';
+		}
+		return all;
+	}
+
+	void removeFiles(const string &path)
+	{
+		for (const char *suffix : {"", ".wurd-journal", ".wurd-snapshot", ".wurd-undo"})
+		{
+			unlink((path + suffix).c_str());
+		}
+	}
+}
+
+int main()
+{
+	string original;
+	for (int row = 0; row < 200; ++row)
+	{
+		original += "line " + to_string(row) + " of the file\n";
+	}
+	string path = "/tmp/wurd-journal-recovery-" + to_string(getpid()) + ".txt";
+	string referencePath = "/tmp/wurd-journal-reference-" + to_string(getpid()) + ".txt";
+	volatile long *done = static_cast<volatile long *>(
+		mmap(nullptr, sizeof(long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+	// a count to stop at, or 0 to be killed after that many ms instead
+	const long stops[] = {300, 30000, 60000};
+	const long killsAfterMs[] = {20, 150, 400};
+	int bad = 0;
+
+	for (int run = 0; run < 8; ++run)
+	{
+		bool changed = run >= 6; // the file, behind the journal's back
+		bool stopping = run < 3 || changed;
+		long stopAt = stopping ? stops[changed ? run - 5 : run] : 0;
+		unsigned seed = 16 + run;
+		removeFiles(path);
+		removeFiles(referencePath);
+		ofstream(path, ios::binary) << original;
+		ofstream(referencePath, ios::binary) << original;
+
+		*done = 0;
+		pid_t child = fork();
+		if (child == 0)
+		{
+			Undo *undo = createUndo();
+			TextEditor *editor = createTextEditor(undo);
+			editor->load(path);
+			mt19937 random(seed);
+			long made = 0;
+			for (;;)
+			{
+				if (made == stopAt && stopping)
+				{
+					pause();
+				}
+				step(editor, random);
+				*done = ++made;
+				if (!stopping)
+				{
+					usleep(20);
+				}
+			}
+		}
+		if (stopping)
+		{
+			while (*done < stopAt)
+			{
+				usleep(1000);
+			}
+			usleep(300000);
+		}
+		else
+		{
+			usleep(killsAfterMs[run - 3] * 1000);
+		}
+		kill(child, SIGKILL);
+		waitpid(child, nullptr, 0);
+		long reached = *done;
+
+		string changedText = original;
+		changedText[0] = 'L';
+		if (changed)
+		{
+			ofstream(path, ios::binary) << changedText;
+		}
+		Undo *undo = createUndo();
+		TextEditor *editor = createTextEditor(undo);
+		editor->load(path);
+		string recovered = text(editor);
+		delete editor;
+		delete undo;
+		if (changed)
+		{
+			printf("run %d: %ld steps made, then the file changed: %s\n", run, reached,
+				recovered == changedText ? "nothing recovered" : "recovered anyway, FAILED");
+			bad += recovered != changedText;
+			continue;
+		}
+
+		// walk a reference through the same stream until it reaches what was recovered
+		Undo *referenceUndo = createUndo();
+		TextEditor *reference = createTextEditor(referenceUndo);
+		reference->load(referencePath);
+		mt19937 random(seed);
+		long matched = -1;
+		for (long made = 0;; ++made)
+		{
+			if ((!stopping || made == stopAt) && text(reference) == recovered)
+			{
+				matched = made;
+				break;
+			}
+			if (made >= reached)
+			{
+				break;
+			}
+			step(reference, random);
+		}
+		delete reference;
+		delete referenceUndo;
+		printf("run %d: %ld steps made, %s%ld\n", run, reached, matched < 0 ? "no match, FAILED at " : "recovered through ",
+			matched < 0 ? reached : matched);
+		bad += matched < 0;
+	}
+
+	removeFiles(path);
+	removeFiles(referencePath);
+	printf("%s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+// line-cache: LineCheckCache against a list of lines kept in recency order.
+//
+// Random finds, inserts and clears over a small pool of lines, several of them the same length, at
+// a few capacities. Every find must hit or miss as the list does, with the problems last inserted
+// for that line, and the size and hit, miss and eviction counts must agree after every step.
+//
+// Then the editor's checker redraws a screen of warandpeace.txt the way EditorGui does, one
+// spellCheckLine() per visible line: the first redraw must miss on every distinct line, the next
+// must hit on all of them, and one after an edit must miss only on the edited line. Its
+// statistics() must show the counts.
+#include "DaemonSpellCheck.h"
+#include "LineCheckCache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <list>
+#include <random>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	typedef vector<SpellCheck::Position> Problems;
+
+	bool same(const Problems &a, const Problems &b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].start != b[i].start || a[i].end != b[i].end)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the hits and misses one redraw of screen adds to the checker's line cache
+	LineCheckCache::Stats redraw(DaemonSpellCheck &checker, const vector<string> &screen)
+	{
+		LineCheckCache::Stats before = checker.lineCacheStats();
+		SpellCheck &asEditorSeesIt = checker;
+		vector<SpellCheck::Position> problems;
+		for (const string &line : screen)
+		{
+			asEditorSeesIt.spellCheckLine(line, problems);
+		}
+		const LineCheckCache::Stats &after = checker.lineCacheStats();
+		return { after.hits - before.hits, after.misses - before.misses, after.evictions - before.evictions };
+	}
+}
+
+int main()
+{
+	mt19937 random(10);
+	vector<string> pool;
+	for (int i = 0; i < 40; ++i)
+	{
+		string line;
+		for (int n = i % 4 == 0 ? 0 : 3 + random() % 3; n > 0; --n)
+		{
+			line += 'a' + random() % 3;
+		}
+		pool.push_back(line + to_string(i % 10));
+	}
+
+	int bad = 0;
+	for (size_t capacity : {1, 2, 7, 64})
+	{
+		LineCheckCache cache(capacity);
+		list<pair<string, Problems>> model; // newest first
+		LineCheckCache::Stats expected = {0, 0, 0};
+		for (int op = 0; op < 50000 && bad < 10; ++op)
+		{
+			const string &line = pool[random() % pool.size()];
+			auto it = model.begin();
+			while (it != model.end() && it->first != line)
+			{
+				++it;
+			}
+
+			int kind = random() % 100;
+			if (kind < 60)
+			{
+				Problems found = { { -1, -1 } };
+				bool hit = cache.find(line, found);
+				if (hit != (it != model.end()) || (hit && !same(found, it->second)))
+				{
+					printf("find: capacity %zu op %d\n", capacity, op);
+					++bad;
+				}
+				if (it != model.end())
+				{
+					model.splice(model.begin(), model, it);
+					++expected.hits;
+				}
+				else
+				{
+					++expected.misses;
+				}
+			}
+			else if (kind < 99)
+			{
+				Problems problems;
+				for (int n = random() % 3; n > 0; --n)
+				{
+					int start = random() % 10;
+					problems.push_back({ start, start + static_cast<int>(random() % 5) });
+				}
+				cache.insert(line, problems);
+				if (it != model.end())
+				{
+					model.erase(it);
+				}
+				else if (model.size() == capacity)
+				{
+					model.pop_back();
+					++expected.evictions;
+				}
+				model.emplace_front(line, problems);
+			}
+			else
+			{
+				cache.clear();
+				model.clear();
+			}
+
+			const LineCheckCache::Stats &stats = cache.stats();
+			if (cache.size() != model.size() || stats.hits != expected.hits || stats.misses != expected.misses ||
+				stats.evictions != expected.evictions)
+			{
+				printf("size or stats: capacity %zu op %d\n", capacity, op);
+				++bad;
+			}
+		}
+	}
+
+	// checked in-process, whether or not a daemon is running
+	setenv("WURDD_SOCKET", ("/tmp/wurd-line-cache-" + to_string(getpid()) + ".sock").c_str(), 1);
+	DaemonSpellCheck checker;
+	ifstream in("warandpeace.txt");
+	vector<string> screen;
+	string line;
+	while (screen.size() < 50 && getline(in, line))
+	{
+		screen.push_back(line);
+	}
+	uint64_t distinct = set<string>(screen.begin(), screen.end()).size();
+	if (!checker.load("dictionary.txt") || screen.size() < 50)
+	{
+		printf("can't load dictionary.txt or read warandpeace.txt\n");
+		return 1;
+	}
+	LineCheckCache::Stats first = redraw(checker, screen);
+	LineCheckCache::Stats second = redraw(checker, screen);
+	screen[20] += " wurd";
+	LineCheckCache::Stats edited = redraw(checker, screen);
+	if (first.misses != distinct || first.hits != screen.size() - distinct || second.misses != 0 ||
+		second.hits != screen.size() || edited.misses != 1 || edited.hits != screen.size() - 1)
+	{
+		printf("redraws: misses %s %s %s, hits %s %s %s\n", to_string(first.misses).c_str(), to_string(second.misses).c_str(),
+			to_string(edited.misses).c_str(), to_string(first.hits).c_str(), to_string(second.hits).c_str(),
+			to_string(edited.hits).c_str());
+		++bad;
+	}
+	string shown = checker.statistics();
+	if (shown.find(to_string(first.hits + second.hits + edited.hits) + " hits") == string::npos ||
+		shown.find(to_string(distinct + 1) + " misses") == string::npos)
+	{
+		printf("statistics: %s\n", shown.c_str());
+		++bad;
+	}
+	printf("%s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+// scanners: WordScanner and NewlineScanner find what a byte-at-a-time loop finds.
+//
+// Random lines, of letters, apostrophes, punctuation, newlines, NULs and bytes >= 0x80, from empty
+// to a few blocks long, are scanned at each classifier the CPU has (WURD_SIMD caps the choice, which
+// is made once per process, so each runs in a child of its own). Fails on any difference.
+#include "NewlineScanner.h"
+#include "WordScanner.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	const int LINES = 50000;
+
+	bool isWordChar(unsigned char ch)
+	{
+		return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '\'';
+	}
+
+	int check(const char *level)
+	{
+		mt19937 random(5);
+		const char alphabet[] = "abcXYZ' .,-\n\t\0\x80\xc3\xff{@[`";
+		int bad = 0;
+		for (int n = 0; n < LINES && bad < 5; ++n)
+		{
+			string line(random() % 200, ' ');
+			for (char &ch : line)
+			{
+				ch = random() % 4 ? alphabet[random() % 6] : alphabet[random() % (sizeof(alphabet) - 1)];
+			}
+
+			// words: the runs of word chars
+			vector<pair<int, int>> expected, found;
+			for (size_t i = 0; i < line.size();)
+			{
+				if (!isWordChar(line[i]))
+				{
+					++i;
+					continue;
+				}
+				size_t start = i;
+				while (i < line.size() && isWordChar(line[i]))
+				{
+					++i;
+				}
+				expected.emplace_back(start, i - 1);
+			}
+			WordScanner words(line.data(), line.size());
+			int start, end;
+			while (words.next(start, end))
+			{
+				found.emplace_back(start, end);
+			}
+
+			// newlines, from anywhere in the line
+			size_t from = line.empty() ? 0 : random() % line.size();
+			vector<size_t> expectedBreaks, foundBreaks;
+			for (size_t i = from; i < line.size(); ++i)
+			{
+				if (line[i] == '\n')
+				{
+					expectedBreaks.push_back(i);
+				}
+			}
+			NewlineScanner breaks(line.data(), line.size(), from);
+			size_t newline;
+			while (breaks.next(newline))
+			{
+				foundBreaks.push_back(newline);
+			}
+
+			if (found != expected || foundBreaks != expectedBreaks)
+			{
+				printf("%s: line %d (%zu bytes): %zu words for %zu, %zu newlines for %zu\n", level, n, line.size(),
+					found.size(), expected.size(), foundBreaks.size(), expectedBreaks.size());
+				++bad;
+			}
+		}
+		printf("%s (word scanner %s, newline scanner %s): %d lines, %s\n", level, WordScanner::implementation(),
+			NewlineScanner::implementation(), LINES, bad ? "FAILED" : "ok");
+		return bad ? 1 : 0;
+	}
+}
+
+int main()
+{
+	int failed = 0;
+	for (const char *level : {"scalar", "sse2", "avx2"})
+	{
+		pid_t child = fork();
+		if (child == 0)
+		{
+			setenv("WURD_SIMD", level, 1);
+			int result = check(level);
+			fflush(stdout);
+			_exit(result);
+		}
+		int status;
+		if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			failed = 1;
+		}
+	}
+	return failed;
+}
@@ -0,0 +1,87 @@
+// spell-alloc: the view forms of the spell checker make no allocations once the caller's buffers
+// have grown.
+//
+// Checks every line of warandpeace.txt and asks for suggestions for every fifth misspelling, twice
+// over with the same buffers. Fails if the second pass allocates at all.
+#include "StudentSpellCheck.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	long allocations = 0;
+}
+
+void *operator new(size_t size)
+{
+	++allocations;
+	void *p = malloc(size ? size : 1);
+	if (!p)
+	{
+		throw bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+int main()
+{
+	StudentSpellCheck checker;
+	if (!checker.load("dictionary.txt"))
+	{
+		printf("can't load dictionary.txt\n");
+		return 1;
+	}
+	ifstream in("warandpeace.txt");
+	vector<string> lines;
+	string line;
+	while (getline(in, line))
+	{
+		lines.push_back(line);
+	}
+	if (lines.empty())
+	{
+		printf("can't read warandpeace.txt\n");
+		return 1;
+	}
+
+	vector<SpellCheck::Position> problems;
+	SpellCheck::SuggestionBuffer suggestions;
+	long counts[2];
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		long before = allocations;
+		long misspelled = 0;
+		for (const string &text : lines)
+		{
+			string_view view(text);
+			checker.spellCheckLine(view, problems);
+			for (const SpellCheck::Position &p : problems)
+			{
+				if (++misspelled % 5 == 0)
+				{
+					checker.spellCheck(view.substr(p.start, p.end - p.start + 1), 10, suggestions);
+				}
+			}
+		}
+		counts[pass] = allocations - before;
+		printf("pass %d: %zu lines, %ld misspelled, %ld allocations\n", pass + 1, lines.size(), misspelled, counts[pass]);
+	}
+	return counts[1] == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// text-buffer: TextBuffer against a vector of strings.
+//
+// Random splits, joins, inserts and erases, weighted in turn towards growing and shrinking the line
+// count so blocks split, empty and are dropped, with the whole document compared every so often.
+// Loaded text (assigned and mapped from a file, with CRLF line ends) is checked the same way, and so
+// are the empty and trailing-newline edge cases. Fails on any difference.
+#include "TextBuffer.h"
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	int bad = 0;
+
+	void expect(bool ok, const char *what, int run, int op)
+	{
+		if (!ok && bad++ < 10)
+		{
+			printf("%s: run %d op %d\n", what, run, op);
+		}
+	}
+
+	bool same(const TextBuffer &buffer, const vector<string> &model)
+	{
+		if (buffer.lineCount() != static_cast<int>(model.size()))
+		{
+			return false;
+		}
+		size_t row = 0;
+		bool equal = true;
+		buffer.forEachLine(0, model.size(), [&](string_view line) {
+			equal = equal && line == model[row++];
+		});
+		string text, expected;
+		buffer.forEachSpan([&](string_view span) {
+			text.append(span);
+		});
+		for (const string &line : model)
+		{
+			expected += line + '\n';
+		}
+		return equal && text == expected;
+	}
+}
+
+int main()
+{
+	mt19937 random(11);
+	string path = "/tmp/wurd-text-buffer-" + to_string(getpid()) + ".txt";
+	for (int run = 0; run < 6; ++run)
+	{
+		// 3000 lines, every third ending in CRLF, which is dropped
+		string text;
+		vector<string> model;
+		for (int i = 0; i < 3000; ++i)
+		{
+			model.push_back("line" + to_string(i));
+			text += model.back() + (i % 3 ? "\n" : "\r\n");
+		}
+		TextBuffer buffer;
+		if (run < 3)
+		{
+			buffer.assign(text);
+		}
+		else
+		{
+			ofstream(path, ios::binary) << text;
+			expect(buffer.load(path), "load", run, 0);
+		}
+		expect(buffer.line(2999) == model[2999] && buffer.line(0) == model[0], "loaded lines", run, 0);
+
+		for (int op = 0; op < 40000; ++op)
+		{
+			int kind = random() % 100;
+			int row = random() % model.size();
+			string &line = model[row];
+			if (kind < 25)
+			{
+				int col = random() % (line.size() + 1);
+				buffer.split(row, col);
+				model.insert(model.begin() + row + 1, line.substr(col));
+				model[row].erase(col);
+			}
+			else if (kind < (run % 2 ? 60 : 45))
+			{
+				if (row + 1 < static_cast<int>(model.size()))
+				{
+					buffer.join(row);
+					line += model[row + 1];
+					model.erase(model.begin() + row + 1);
+				}
+			}
+			else if (kind < 75)
+			{
+				int col = random() % (line.size() + 1);
+				string inserted(random() % 4, 'a' + random() % 26);
+				buffer.insert(row, col, inserted);
+				line.insert(col, inserted);
+			}
+			else if (kind < 90)
+			{
+				if (!line.empty())
+				{
+					int col = random() % line.size();
+					int count = 1 + random() % (line.size() - col);
+					buffer.erase(row, col, count);
+					line.erase(col, count);
+				}
+			}
+			else
+			{
+				int col = line.empty() ? 0 : random() % line.size();
+				int count = line.empty() ? 0 : random() % (line.size() - col + 1);
+				expect(buffer.line(row) == line, "line", run, op);
+				expect(buffer.lineLength(row) == static_cast<int>(line.size()), "lineLength", run, op);
+				expect(buffer.substr(row, col, count) == line.substr(col, count), "substr", run, op);
+				expect(line.empty() || buffer.at(row, col) == line[col], "at", run, op);
+			}
+			expect(buffer.lineCount() == static_cast<int>(model.size()), "lineCount", run, op);
+			if (op % 5000 == 0)
+			{
+				expect(same(buffer, model), "document", run, op);
+			}
+		}
+		expect(same(buffer, model), "document", run, -1);
+		printf("run %d: %zu lines\n", run, model.size());
+	}
+	unlink(path.c_str());
+
+	// there is always a line, and a final newline doesn't start another
+	TextBuffer edge;
+	edge.assign("");
+	expect(edge.lineCount() == 1 && edge.line(0).empty(), "empty", -1, 0);
+	edge.assign("a\n");
+	expect(edge.lineCount() == 1, "one line", -1, 0);
+	edge.assign("a\n\n");
+	expect(edge.lineCount() == 2, "blank last line", -1, 0);
+
+	printf("%s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+// undo-coalescing: the records a typed session makes under each Coalescing policy.
+//
+// The same short session is replayed in an editor under several policies, on a clock the test moves
+// on by hand: three lines typed a key every 100 ms with Enter between them, a 3 s pause, two more
+// keys, and two backspaces. submitted() must count every keystroke and recorded() the records the
+// policy should make of them; undoing that many times, and no fewer, must empty the document.
+#include "StudentUndo.h"
+#include "TextEditor.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	uint64_t now = 0;
+
+	uint64_t fakeClock()
+	{
+		return now;
+	}
+
+	bool empty(const TextEditor *editor)
+	{
+		vector<string> lines;
+		editor->getLines(0, 2, lines);
+		return lines.empty() || (lines.size() == 1 && lines[0].empty());
+	}
+
+	bool replay(const char *name, StudentUndo::Coalescing policy, size_t records)
+	{
+		policy.clock = fakeClock;
+		StudentUndo undo;
+		undo.setCoalescing(policy);
+		TextEditor *editor = createTextEditor(&undo);
+		editor->reset();
+		for (int line = 0; line < 3; ++line)
+		{
+			if (line > 0)
+			{
+				now += 100;
+				editor->enter();
+			}
+			for (char ch : string("the cat sat"))
+			{
+				now += 100;
+				editor->insert(ch);
+			}
+		}
+		now += 3000;
+		for (char ch : string("xy"))
+		{
+			editor->insert(ch);
+			now += 100;
+		}
+		editor->backspace();
+		now += 100;
+		editor->backspace();
+
+		bool ok = undo.submitted() == 39 && undo.recorded() == records;
+		for (size_t i = 0; i + 1 < undo.recorded(); ++i)
+		{
+			editor->undo();
+		}
+		ok = ok && !empty(editor);
+		editor->undo();
+		ok = ok && empty(editor);
+		printf("%-24s %zu keystrokes, %zu records%s\n", name, undo.submitted(), undo.recorded(), ok ? "" : "  FAILED");
+		delete editor;
+		return ok;
+	}
+}
+
+int main()
+{
+	StudentUndo::Coalescing defaults;
+	StudentUndo::Coalescing sameRow;
+	sameRow.acrossLines = false;
+	sameRow.pauseMs = 0;
+	StudentUndo::Coalescing words;
+	words.words = true;
+
+	bool ok = true;
+	// one record for the three lines, one after the pause, one for the backspaces
+	ok = replay("across lines, 2 s pause", defaults, 3) && ok;
+	// a record per line and per Enter; the two keys after the pause batch onto the last line
+	ok = replay("same row, no pause", sameRow, 6) && ok;
+	// a record per word, the spaces and Enters batching onto it, then as with the defaults
+	ok = replay("+ word boundaries", words, 11) && ok;
+	printf("%s\n", ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// undo-history: the undo history saved beside a document comes back when it is reopened unchanged.
+//
+// A document is edited and saved twice, then reopened in a fresh editor, which must undo back through
+// both saves. The history must be turned away without hashing the document when its size differs,
+// and hashed only on the first undo when size and time match. A document whose text changed with its
+// size and time put back must lose the loaded history on that first undo, keeping the edits made
+// since it was opened. A save must also delete the temporary file a crashed save of the document left
+// behind, but not one whose process is still running. Fails on any difference.
+#include "ContentHash.h"
+#include "StudentUndo.h"
+#include "TextEditor.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	int bad = 0;
+
+	void expect(bool ok, const char *what)
+	{
+		if (!ok)
+		{
+			printf("%s\n", what);
+			++bad;
+		}
+	}
+
+	string text(const TextEditor *editor)
+	{
+		vector<string> lines;
+		editor->getLines(0, 1 << 30, lines);
+		string all;
+		for (const string &line : lines)
+		{
+			all += line + '\n';
+		}
+		return all;
+	}
+}
+
+int main()
+{
+	string path = "/tmp/wurd-undo-history-" + to_string(getpid()) + ".txt";
+	string history = path + ".wurd-undo";
+	ofstream(path, ios::binary) << "first line\nsecond line\n";
+
+	StudentUndo undo;
+	TextEditor *editor = createTextEditor(&undo);
+	editor->load(path);
+	for (char ch : string("abc"))
+	{
+		editor->insert(ch);
+	}
+	editor->save(path);
+	editor->enter();
+	editor->insert('x');
+
+	// temporary files as a crashed save and one still in progress would leave them
+	pid_t gone = fork();
+	if (gone == 0)
+	{
+		_exit(0);
+	}
+	waitpid(gone, nullptr, 0);
+	string crashed = path + ".wurd-save" + to_string(gone) + "-0";
+	string inProgress = path + ".wurd-save" + to_string(getppid()) + "-0";
+	ofstream(crashed) << "partial";
+	ofstream(inProgress) << "partial";
+	editor->save(path);
+	expect(access(crashed.c_str(), F_OK) != 0, "crashed save's temporary file left behind");
+	expect(access(inProgress.c_str(), F_OK) == 0, "running save's temporary file deleted");
+	unlink(inProgress.c_str());
+	string saved = text(editor);
+	delete editor;
+
+	// reopened unchanged, it undoes through both saves
+	{
+		StudentUndo reopened;
+		TextEditor *again = createTextEditor(&reopened);
+		again->load(path);
+		expect(text(again) == saved, "reopened text differs");
+		again->undo();
+		again->undo();
+		expect(text(again) == "first line\nsecond line\n", "history not brought back");
+		again->redo();
+		again->redo();
+		expect(text(again) == saved, "history not redone");
+		delete again;
+	}
+
+	// the document is hashed only when the history is first used, and not at all if its size is off
+	struct stat info;
+	stat(path.c_str(), &info);
+#ifdef __APPLE__
+	struct timespec accessed = info.st_atimespec, modified = info.st_mtimespec;
+#else
+	struct timespec accessed = info.st_atim, modified = info.st_mtim;
+#endif
+	int64_t mtime = modified.tv_sec * 1000000000ll + modified.tv_nsec;
+	string contents = saved;
+	int hashed = 0;
+	auto hash = [&] {
+		++hashed;
+		return ContentHash::of(contents);
+	};
+	{
+		StudentUndo direct;
+		expect(!direct.loadHistory(history, info.st_size + 1, mtime, hash) && hashed == 0, "loaded for another size");
+		expect(direct.loadHistory(history, info.st_size, mtime, hash) && hashed == 0, "hashed while loading");
+		int row, col, count;
+		string undone;
+		direct.get(row, col, count, undone);
+		direct.get(row, col, count, undone);
+		expect(hashed == 1, "not hashed once on first use");
+	}
+
+	// the text changed behind the history's back, with size and time put back: the loaded history
+	// goes, and what was typed since stays
+	contents[0] = 'F';
+	ofstream(path, ios::binary) << contents;
+	struct timespec times[2] = { accessed, modified };
+	utimensat(AT_FDCWD, path.c_str(), times, 0);
+	{
+		StudentUndo reopened;
+		TextEditor *again = createTextEditor(&reopened);
+		again->load(path);
+		again->insert('!');
+		string typed = text(again);
+		again->undo();
+		expect(text(again) == contents, "edit since opening not undone");
+		again->undo();
+		expect(text(again) == contents, "stale history undone");
+		again->redo();
+		expect(text(again) == typed, "edit since opening not redone");
+		delete again;
+	}
+
+	unlink(path.c_str());
+	unlink(history.c_str());
+	unlink((path + ".wurd-journal").c_str());
+	printf("%s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,117 @@
+// undo-submit-text: StudentUndo::submitText() makes the same history as submitting each char.
+//
+// Two histories are fed the same random mix of submitText() and submit() calls, one through
+// StudentUndo's override and the other through the Undo default that submits a char at a time,
+// with undos in between; then both are undone to the end and redone to the end, and every change
+// they hand back must agree. The clock stands still, so no pause splits a batch. Then pastes go into
+// a history with a memory limit that the first char of some of them fits under but the rest doesn't;
+// the limit must hold after every one, with the newest paste kept.
+#include "StudentUndo.h"
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace std;
+
+namespace
+{
+	uint64_t stoppedClock()
+	{
+		return 0;
+	}
+
+	bool same(Undo::Action a, Undo::Action b, int rowA, int rowB, int colA, int colB, int countA, int countB,
+		const string &textA, const string &textB)
+	{
+		return a == b && rowA == rowB && colA == colB && countA == countB && textA == textB;
+	}
+}
+
+int main()
+{
+	mt19937 random(23);
+	StudentUndo::Coalescing policy;
+	policy.clock = stoppedClock;
+	int bad = 0;
+	for (int run = 0; run < 2000; ++run)
+	{
+		StudentUndo whole, chars;
+		whole.setCoalescing(policy);
+		chars.setCoalescing(policy);
+		for (int op = 0; op < 30; ++op)
+		{
+			int kind = random() % 4;
+			int row = random() % 2;
+			int col = random() % 6;
+			string text;
+			for (int n = random() % 4; n > 0; --n)
+			{
+				text += 'a' + random() % 3;
+			}
+			if (kind < 2)
+			{
+				Undo::Action action = kind == 0 ? Undo::INSERT : Undo::DELETE;
+				whole.submitText(action, row, col, text);
+				chars.Undo::submitText(action, row, col, text);
+			}
+			else if (kind == 2)
+			{
+				Undo::Action action = random() % 2 ? Undo::INSERT : Undo::DELETE;
+				whole.submit(action, row, col, 'x');
+				chars.submit(action, row, col, 'x');
+			}
+			else
+			{
+				int r, c, n;
+				string s;
+				whole.get(r, c, n, s);
+				chars.get(r, c, n, s);
+			}
+		}
+
+		bool ok = whole.submitted() == chars.submitted() && whole.recorded() == chars.recorded();
+		for (bool redoing : {false, true})
+		{
+			for (;;)
+			{
+				int rowA, colA, countA, rowB, colB, countB;
+				string textA, textB;
+				Undo::Action a = redoing ? whole.redo(rowA, colA, countA, textA) : whole.get(rowA, colA, countA, textA);
+				Undo::Action b = redoing ? chars.redo(rowB, colB, countB, textB) : chars.get(rowB, colB, countB, textB);
+				if (!same(a, b, rowA, rowB, colA, colB, countA, countB, textA, textB))
+				{
+					ok = false;
+					break;
+				}
+				if (a == Undo::ERROR)
+				{
+					break;
+				}
+			}
+		}
+		if (!ok && bad++ < 10)
+		{
+			printf("run %d differs\n", run);
+		}
+	}
+
+	StudentUndo limited;
+	limited.setCoalescing(policy);
+	limited.setMemoryLimit(1 << 16);
+	for (int paste = 0; paste < 50; ++paste)
+	{
+		limited.submitText(Undo::INSERT, paste, 0, string(10000, 'a' + paste % 26));
+		size_t used = limited.memoryUsed();
+		int row, col, count;
+		string undone;
+		bool newestKept = limited.get(row, col, count, undone) == Undo::DELETE && row == paste && count == 10000;
+		limited.redo(row, col, count, undone);
+		if (used > (1 << 16) || !newestKept)
+		{
+			printf("paste %d: %zu bytes kept\n", paste, used);
+			++bad;
+		}
+	}
+	printf("%s\n", bad ? "FAILED" : "ok");
+	return bad ? 1 : 0;
+}
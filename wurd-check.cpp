@@ -0,0 +1,188 @@
+// wurd-check: spell-check files from the command line, without the editor.
+//
+// usage: wurd-check [-d DICTIONARY] [-j JOBS] [-n SUGGESTIONS] FILE...
+//
+// Prints one line per misspelled word as FILE:LINE:COLUMN: WORD -> SUGGESTION, SUGGESTION, ...
+// with columns counted in bytes from 1. The dictionary (default dictionary.txt, or a compiled image)
+// is loaded once and shared by JOBS threads checking files in parallel (default one per core);
+// output stays in argument order. SUGGESTIONS defaults to 5, and 0 skips them, which is much faster.
+//
+// Exits 0 if every word was found, 1 if any was misspelled, and 2 if a file couldn't be read.
+
+#include "MappedFile.h"
+#include "StudentSpellCheck.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	struct FileResult
+	{
+		string output;
+		int misspelled;
+		bool failed;
+	};
+
+	void checkFile(StudentSpellCheck &checker, const string &path, int maxSuggestions, FileResult &result)
+	{
+		result.output.clear();
+		result.misspelled = 0;
+
+		MappedFile file;
+		result.failed = !file.open(path);
+		if (result.failed)
+		{
+			return;
+		}
+
+		vector<SpellCheck::Position> problems;
+		SpellCheck::SuggestionBuffer suggestions;
+		const char *text = file.data();
+		size_t size = file.size();
+		int lineNumber = 0;
+		for (size_t pos = 0; pos < size; ++lineNumber)
+		{
+			// lines are checked in place in the mapping; a CR before the newline isn't part of the line
+			const char *newline = static_cast<const char *>(memchr(text + pos, '\n', size - pos));
+			size_t end = newline != nullptr ? newline - text : size;
+			string_view line(text + pos, end - pos);
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.remove_suffix(1);
+			}
+			pos = end + 1;
+
+			checker.spellCheckLine(line, problems);
+			for (auto it = problems.begin(); it != problems.end(); ++it)
+			{
+				string_view word = line.substr(it->start, it->end - it->start + 1);
+				char location[32];
+				snprintf(location, sizeof(location), ":%d:%d: ", lineNumber + 1, it->start + 1);
+				result.output += path;
+				result.output += location;
+				result.output += word;
+
+				if (maxSuggestions > 0)
+				{
+					checker.spellCheck(word, maxSuggestions, suggestions);
+					for (int i = 0; i < suggestions.size(); ++i)
+					{
+						result.output += i == 0 ? " -> " : ", ";
+						result.output += suggestions[i];
+					}
+				}
+				result.output += '\n';
+				++result.misspelled;
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	string dictionary = "dictionary.txt";
+	int jobs = 0;
+	int maxSuggestions = 5;
+	vector<string> files;
+	bool usage = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-d" && i + 1 < argc)
+		{
+			dictionary = argv[++i];
+		}
+		else if (arg == "-j" && i + 1 < argc)
+		{
+			jobs = atoi(argv[++i]);
+		}
+		else if (arg == "-n" && i + 1 < argc)
+		{
+			maxSuggestions = max(0, atoi(argv[++i]));
+		}
+		else if (arg.empty() || arg[0] != '-')
+		{
+			files.push_back(arg);
+		}
+		else
+		{
+			usage = true;
+			break;
+		}
+	}
+
+	if (usage || files.empty())
+	{
+		cerr << "usage: wurd-check [-d DICTIONARY] [-j JOBS] [-n SUGGESTIONS] FILE..." << endl;
+		return 2;
+	}
+
+	StudentSpellCheck checker;
+	if (!checker.load(dictionary))
+	{
+		cerr << "wurd-check: can't load dictionary " << dictionary << endl;
+		return 2;
+	}
+
+	// the calling thread checks files too, so JOBS runners need one fewer pool thread
+	if (jobs <= 0)
+	{
+		jobs = max(1u, thread::hardware_concurrency());
+	}
+	unique_ptr<ThreadPool> pool;
+	if (jobs > 1)
+	{
+		pool.reset(new ThreadPool(jobs - 1));
+	}
+
+	// files are checked a round at a time and printed in order as each round finishes
+	size_t roundSize = jobs * 4;
+	vector<FileResult> results(roundSize);
+	bool misspelled = false;
+	bool failed = false;
+	for (size_t first = 0; first < files.size(); first += roundSize)
+	{
+		size_t count = min(roundSize, files.size() - first);
+		auto checkFiles = [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+			{
+				checkFile(checker, files[first + i], maxSuggestions, results[i]);
+			}
+		};
+		if (pool)
+		{
+			pool->parallelFor(count, 1, checkFiles);
+		}
+		else
+		{
+			checkFiles(0, count);
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (results[i].failed)
+			{
+				fflush(stdout);
+				cerr << "wurd-check: can't read " << files[first + i] << endl;
+				failed = true;
+				continue;
+			}
+			fwrite(results[i].output.data(), 1, results[i].output.size(), stdout);
+			misspelled = misspelled || results[i].misspelled > 0;
+		}
+	}
+
+	fflush(stdout);
+	return failed ? 2 : misspelled ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+// wurd-dictc: compile a plain-text word list into a binary dictionary image.
+//
+// usage: wurd-dictc WORDLIST [-c CORPUS]... [-o IMAGE]
+//
+// By default the image is written where wurd looks for its cached copy of WORDLIST, so the next
+// launch maps it instead of re-parsing the text. An explicit IMAGE can also be passed to wurd as
+// the dictionary directly.
+//
+// Each CORPUS is a plain text whose words are counted; the counts are stored in the image as
+// 4-bit classes (roughly log2 of the count) and used to put common words first among suggestions.
+
+#include "DictImage.h"
+#include "FlatTrie.h"
+#include "MappedFile.h"
+#include "WordScanner.h"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	bool countWords(const string &path, const FlatTrie &trie, vector<uint64_t> &counts)
+	{
+		MappedFile corpus;
+		if (!corpus.open(path))
+		{
+			return false;
+		}
+
+		// a line at a time, so word offsets stay small
+		const char *text = corpus.data();
+		size_t size = corpus.size();
+		for (size_t pos = 0; pos < size;)
+		{
+			const char *newline = static_cast<const char *>(memchr(text + pos, '\n', size - pos));
+			size_t end = newline != nullptr ? newline - text : size;
+			WordScanner words(text + pos, end - pos);
+			int start, last;
+			while (words.next(start, last))
+			{
+				int node = trie.find(string_view(text + pos + start, last - start + 1));
+				if (node != FlatTrie::NO_NODE)
+				{
+					++counts[node];
+				}
+			}
+			pos = end + 1;
+		}
+		return true;
+	}
+
+	int frequencyClass(uint64_t count)
+	{
+		// 0 for unseen words, then one class per doubling
+		int frequency = 0;
+		for (; count > 0 && frequency < FlatTrie::MAX_FREQUENCY; count >>= 1)
+		{
+			++frequency;
+		}
+		return frequency;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	string wordList;
+	string output;
+	vector<string> corpora;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+		{
+			output = argv[++i];
+		}
+		else if (arg == "-c" && i + 1 < argc)
+		{
+			corpora.push_back(argv[++i]);
+		}
+		else if (wordList.empty() && arg[0] != '-')
+		{
+			wordList = arg;
+		}
+		else
+		{
+			wordList.clear();
+			break;
+		}
+	}
+
+	if (wordList.empty())
+	{
+		cerr << "usage: wurd-dictc WORDLIST [-c CORPUS]... [-o IMAGE]" << endl;
+		return 2;
+	}
+	if (output.empty())
+	{
+		output = dictCachePath(wordList);
+	}
+
+	DictStamp stamp;
+	vector<string> words;
+	if (!statDictSource(wordList, stamp) || !readWordList(wordList, words))
+	{
+		cerr << "wurd-dictc: can't read " << wordList << endl;
+		return 1;
+	}
+
+	FlatTrie trie;
+	trie.build(words);
+
+	vector<uint64_t> counts(corpora.empty() ? 0 : trie.size());
+	for (auto it = corpora.begin(); it != corpora.end(); ++it)
+	{
+		if (!countWords(*it, trie, counts))
+		{
+			cerr << "wurd-dictc: can't read " << *it << endl;
+			return 1;
+		}
+	}
+	size_t seen = 0;
+	for (size_t node = 0; node < counts.size(); ++node)
+	{
+		if (counts[node] > 0)
+		{
+			trie.setFrequency(node, frequencyClass(counts[node]));
+			++seen;
+		}
+	}
+	if (!writeDictImage(output, trie, stamp))
+	{
+		cerr << "wurd-dictc: can't write " << output << endl;
+		return 1;
+	}
+
+	cout << output << ": " << words.size() << " words, " << trie.size() << " nodes";
+	if (!corpora.empty())
+	{
+		cout << ", " << seen << " seen in the corpus";
+	}
+	cout << endl;
+	return 0;
+}
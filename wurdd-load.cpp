@@ -0,0 +1,172 @@
+// wurdd-load: measure wurdd throughput and latency under concurrent clients.
+//
+// usage: wurdd-load [-s SOCKET] [-t SECONDS] [-p PIPELINE] [-c CLIENTS[,CLIENTS...]] TEXTFILE
+//
+// Every client opens its own connection and replays the lines of TEXTFILE as CHECK_LINE requests,
+// with every tenth request a SUGGEST for the first word of the line. PIPELINE requests are sent
+// per round trip. Reports requests/second and p50/p99 latency for each client count (default 1,10,50).
+
+#include "SpellProtocol.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	typedef chrono::steady_clock Clock;
+
+	struct ClientResult
+	{
+		vector<double> latencies; // microseconds
+		bool failed;
+	};
+
+	void runClient(const string &socketPath, const vector<string> &lines, size_t firstLine, int pipeline,
+				   Clock::time_point deadline, ClientResult &result)
+	{
+		SpellConnection connection;
+		result.failed = !connection.connect(socketPath);
+
+		size_t next = firstLine;
+		SpellResponseHeader header;
+		string payload;
+		while (!result.failed && Clock::now() < deadline)
+		{
+			for (int i = 0; i < pipeline; ++i, ++next)
+			{
+				const string &line = lines[next % lines.size()];
+				if (next % 10 == 0)
+				{
+					connection.send(SPELL_SUGGEST, line.substr(0, line.find(' ')), 20);
+				}
+				else
+				{
+					connection.send(SPELL_CHECK_LINE, line);
+				}
+			}
+
+			Clock::time_point sent = Clock::now();
+			result.failed = !connection.flush();
+			for (int i = 0; i < pipeline && !result.failed; ++i)
+			{
+				result.failed = !connection.receive(header, payload);
+				result.latencies.push_back(chrono::duration<double, micro>(Clock::now() - sent).count());
+			}
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	string socketPath = defaultSpellSocketPath();
+	string textFile;
+	double seconds = 2;
+	int pipeline = 1;
+	vector<int> clientCounts = {1, 10, 50};
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-s" && i + 1 < argc)
+		{
+			socketPath = argv[++i];
+		}
+		else if (arg == "-t" && i + 1 < argc)
+		{
+			seconds = atof(argv[++i]);
+		}
+		else if (arg == "-p" && i + 1 < argc)
+		{
+			pipeline = max(1, atoi(argv[++i]));
+		}
+		else if (arg == "-c" && i + 1 < argc)
+		{
+			clientCounts.clear();
+			stringstream list(argv[++i]);
+			string count;
+			while (getline(list, count, ','))
+			{
+				clientCounts.push_back(max(1, atoi(count.c_str())));
+			}
+		}
+		else if (textFile.empty() && arg[0] != '-')
+		{
+			textFile = arg;
+		}
+		else
+		{
+			textFile.clear();
+			break;
+		}
+	}
+
+	if (textFile.empty())
+	{
+		cerr << "usage: wurdd-load [-s SOCKET] [-t SECONDS] [-p PIPELINE] [-c CLIENTS[,CLIENTS...]] TEXTFILE" << endl;
+		return 2;
+	}
+
+	vector<string> lines;
+	ifstream infile(textFile);
+	string line;
+	while (getline(infile, line))
+	{
+		if (!line.empty())
+		{
+			lines.push_back(line);
+		}
+	}
+	if (lines.empty())
+	{
+		cerr << "wurdd-load: no text in " << textFile << endl;
+		return 1;
+	}
+
+	printf("%8s %12s %10s %10s\n", "clients", "requests/s", "p50 us", "p99 us");
+	for (auto count = clientCounts.begin(); count != clientCounts.end(); ++count)
+	{
+		vector<ClientResult> results(*count);
+		vector<thread> clients;
+		Clock::time_point start = Clock::now();
+		Clock::time_point deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(seconds));
+		for (int i = 0; i < *count; ++i)
+		{
+			size_t firstLine = lines.size() * i / *count;
+			clients.emplace_back(runClient, cref(socketPath), cref(lines), firstLine, pipeline, deadline, ref(results[i]));
+		}
+		for (auto it = clients.begin(); it != clients.end(); ++it)
+		{
+			it->join();
+		}
+		double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+		vector<double> latencies;
+		for (auto it = results.begin(); it != results.end(); ++it)
+		{
+			if (it->failed)
+			{
+				cerr << "wurdd-load: can't talk to wurdd on " << socketPath << endl;
+				return 1;
+			}
+			latencies.insert(latencies.end(), it->latencies.begin(), it->latencies.end());
+		}
+		if (latencies.empty())
+		{
+			continue;
+		}
+
+		sort(latencies.begin(), latencies.end());
+		printf("%8d %12.0f %10.1f %10.1f\n", *count, latencies.size() / elapsed,
+			   latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]);
+	}
+	return 0;
+}
@@ -0,0 +1,440 @@
+// wurdd: share one loaded dictionary between every wurd session on the machine.
+//
+// usage: wurdd [-s SOCKET] [-j WORKERS] DICTIONARY
+//
+// Clients connect over a Unix domain socket (see SpellProtocol.h). One thread polls all the
+// connections; whenever a connection has complete requests buffered, the whole batch is handed to
+// a worker pool, which answers every request in it and writes the responses back with one send.
+// A connection has at most one batch in flight, so its responses stay in request order.
+
+#include "DictImage.h"
+#include "SpellProtocol.h"
+#include "StudentSpellCheck.h"
+#include "ThreadPool.h"
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // SIGPIPE is ignored instead
+#endif
+
+namespace
+{
+	int g_wakeWrite = -1;
+	volatile sig_atomic_t g_stopping = 0;
+
+	void onStopSignal(int)
+	{
+		g_stopping = 1;
+		char byte = 0;
+		ssize_t ignored = write(g_wakeWrite, &byte, 1);
+		(void)ignored;
+	}
+
+	class SpellServer
+	{
+	public:
+		SpellServer(StudentSpellCheck &checker, const string &dictPath, const DictStamp &stamp, int workers);
+		~SpellServer();
+		bool listen(const string &socketPath);
+		void run();
+
+	private:
+		struct Connection
+		{
+			string inbox;
+			bool busy;	  // a batch from this connection is being answered by a worker
+			bool closing; // the client hung up; close once the batch in flight is done
+		};
+
+		StudentSpellCheck &m_checker;
+		string m_dictPath;
+		DictStamp m_stamp;
+		unique_ptr<ThreadPool> m_pool;
+		string m_socketPath;
+		int m_listenFd;
+		int m_wakeRead;
+		map<int, Connection> m_connections;
+		mutex m_doneMutex;
+		vector<int> m_done; // connections whose batch has been answered
+
+		void accept();
+		void receive(int fd, Connection &connection);
+		void dispatch(int fd, Connection &connection);
+		void finishBatches();
+		void closeConnection(int fd);
+		void answer(int fd, const string &batch);
+	};
+
+	SpellServer::SpellServer(StudentSpellCheck &checker, const string &dictPath, const DictStamp &stamp, int workers)
+		: m_checker(checker), m_dictPath(dictPath), m_stamp(stamp), m_pool(new ThreadPool(workers)),
+		  m_listenFd(-1), m_wakeRead(-1)
+	{
+	}
+
+	SpellServer::~SpellServer()
+	{
+		// workers may still be writing to connections, so stop them first
+		m_pool.reset();
+		for (auto it = m_connections.begin(); it != m_connections.end(); ++it)
+		{
+			close(it->first);
+		}
+		if (m_listenFd >= 0)
+		{
+			close(m_listenFd);
+			unlink(m_socketPath.c_str());
+		}
+	}
+
+	bool SpellServer::listen(const string &socketPath)
+	{
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (socketPath.size() >= sizeof(address.sun_path))
+		{
+			cerr << "wurdd: socket path too long: " << socketPath << endl;
+			return false;
+		}
+		memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+		// a socket file nobody answers on is left over from a daemon that died
+		SpellConnection probe;
+		if (probe.connect(socketPath))
+		{
+			cerr << "wurdd: already running on " << socketPath << endl;
+			return false;
+		}
+		unlink(socketPath.c_str());
+
+		m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (m_listenFd < 0)
+		{
+			return false;
+		}
+
+		// only the owner may connect
+		mode_t oldMask = umask(077);
+		bool bound = bind(m_listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0;
+		umask(oldMask);
+		if (!bound || ::listen(m_listenFd, SOMAXCONN) != 0)
+		{
+			cerr << "wurdd: can't listen on " << socketPath << ": " << strerror(errno) << endl;
+			close(m_listenFd);
+			m_listenFd = -1;
+			return false;
+		}
+
+		m_socketPath = socketPath;
+		return true;
+	}
+
+	void SpellServer::run()
+	{
+		// workers and signal handlers wake the poll loop through this pipe
+		int wake[2];
+		if (pipe(wake) != 0)
+		{
+			return;
+		}
+		m_wakeRead = wake[0];
+		g_wakeWrite = wake[1];
+		fcntl(g_wakeWrite, F_SETFL, O_NONBLOCK); // a full pipe already means the loop will wake
+		signal(SIGINT, onStopSignal);
+		signal(SIGTERM, onStopSignal);
+
+		vector<pollfd> fds;
+		while (!g_stopping)
+		{
+			// idle connections only; busy ones are read again once their batch is answered
+			fds.clear();
+			fds.push_back(pollfd{m_wakeRead, POLLIN, 0});
+			fds.push_back(pollfd{m_listenFd, POLLIN, 0});
+			for (auto it = m_connections.begin(); it != m_connections.end(); ++it)
+			{
+				if (!it->second.busy)
+				{
+					fds.push_back(pollfd{it->first, POLLIN, 0});
+				}
+			}
+
+			if (poll(fds.data(), fds.size(), -1) < 0)
+			{
+				continue;
+			}
+
+			if (fds[0].revents)
+			{
+				char drain[256];
+				ssize_t ignored = read(m_wakeRead, drain, sizeof(drain));
+				(void)ignored;
+				finishBatches();
+			}
+			if (fds[1].revents)
+			{
+				accept();
+			}
+			for (size_t i = 2; i < fds.size(); ++i)
+			{
+				auto found = m_connections.find(fds[i].fd);
+				if (fds[i].revents && found != m_connections.end())
+				{
+					receive(found->first, found->second);
+				}
+			}
+		}
+	}
+
+	void SpellServer::accept()
+	{
+		// the socket's directory keeps other users out already; this is in case it was given with -s
+		int fd = ::accept(m_listenFd, nullptr, nullptr);
+		if (fd >= 0 && !peerIsThisUser(fd))
+		{
+			close(fd);
+		}
+		else if (fd >= 0)
+		{
+			m_connections[fd] = Connection{"", false, false};
+		}
+	}
+
+	void SpellServer::receive(int fd, Connection &connection)
+	{
+		char chunk[65536];
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n < 0 && errno == EINTR)
+		{
+			return;
+		}
+		if (n <= 0)
+		{
+			closeConnection(fd);
+			return;
+		}
+
+		connection.inbox.append(chunk, n);
+		dispatch(fd, connection);
+	}
+
+	void SpellServer::dispatch(int fd, Connection &connection)
+	{
+		// find the prefix of the inbox made of complete requests
+		size_t end = 0;
+		while (connection.inbox.size() - end >= sizeof(SpellRequestHeader))
+		{
+			SpellRequestHeader header;
+			memcpy(&header, connection.inbox.data() + end, sizeof(header));
+			if (header.length > SPELL_MAX_PAYLOAD)
+			{
+				closeConnection(fd);
+				return;
+			}
+			if (connection.inbox.size() - end < sizeof(header) + header.length)
+			{
+				break;
+			}
+			end += sizeof(header) + header.length;
+		}
+
+		if (end == 0)
+		{
+			return;
+		}
+
+		// hand the whole batch to one worker
+		string batch = connection.inbox.substr(0, end);
+		connection.inbox.erase(0, end);
+		connection.busy = true;
+		m_pool->submit([this, fd, batch] {
+			answer(fd, batch);
+
+			lock_guard<mutex> lock(m_doneMutex);
+			m_done.push_back(fd);
+			char byte = 0;
+			ssize_t ignored = write(g_wakeWrite, &byte, 1);
+			(void)ignored;
+		});
+	}
+
+	void SpellServer::finishBatches()
+	{
+		vector<int> done;
+		{
+			lock_guard<mutex> lock(m_doneMutex);
+			done.swap(m_done);
+		}
+
+		for (auto it = done.begin(); it != done.end(); ++it)
+		{
+			auto found = m_connections.find(*it);
+			if (found == m_connections.end())
+			{
+				continue;
+			}
+
+			// the client may have pipelined more requests while this batch was being answered
+			found->second.busy = false;
+			if (found->second.closing)
+			{
+				closeConnection(*it);
+			}
+			else
+			{
+				dispatch(*it, found->second);
+			}
+		}
+	}
+
+	void SpellServer::closeConnection(int fd)
+	{
+		auto found = m_connections.find(fd);
+		if (found == m_connections.end())
+		{
+			return;
+		}
+
+		// a worker is still using the descriptor; finishBatches() closes it later
+		if (found->second.busy)
+		{
+			found->second.closing = true;
+			return;
+		}
+		close(fd);
+		m_connections.erase(found);
+	}
+
+	void SpellServer::answer(int fd, const string &batch)
+	{
+		// runs on a worker; the checker is only read, so any number of these can run at once
+		string out;
+		vector<SpellCheck::Position> problems;
+		SpellCheck::SuggestionBuffer suggestions;
+		for (size_t pos = 0; pos < batch.size();)
+		{
+			SpellRequestHeader header;
+			memcpy(&header, batch.data() + pos, sizeof(header));
+			string_view payload = string_view(batch).substr(pos + sizeof(header), header.length);
+			pos += sizeof(header) + header.length;
+
+			size_t start;
+			switch (header.op)
+			{
+			case SPELL_HELLO:
+				start = beginSpellResponse(out, header.id, SPELL_OK);
+				encodeHello(out, m_stamp.size, m_stamp.mtime, m_dictPath);
+				break;
+			case SPELL_CHECK_LINE:
+				start = beginSpellResponse(out, header.id, SPELL_OK);
+				m_checker.spellCheckLine(payload, problems);
+				encodePositions(out, problems);
+				break;
+			case SPELL_SUGGEST:
+			{
+				start = beginSpellResponse(out, header.id, SPELL_OK);
+				bool correct = m_checker.spellCheck(payload, header.maxSuggestions, suggestions);
+				encodeSuggestions(out, correct, suggestions);
+				break;
+			}
+			default:
+				start = beginSpellResponse(out, header.id, SPELL_BAD_REQUEST);
+				break;
+			}
+			endSpellResponse(out, start);
+		}
+
+		// one send for the whole batch; a failed send is noticed when the client's hangup is read
+		size_t written = 0;
+		while (written < out.size())
+		{
+			ssize_t n = send(fd, out.data() + written, out.size() - written, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (n <= 0)
+			{
+				break;
+			}
+			written += n;
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	string socketPath = defaultSpellSocketPath();
+	string dictionary;
+	int workers = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-s" && i + 1 < argc)
+		{
+			socketPath = argv[++i];
+		}
+		else if (arg == "-j" && i + 1 < argc)
+		{
+			workers = atoi(argv[++i]);
+		}
+		else if (dictionary.empty() && arg[0] != '-')
+		{
+			dictionary = arg;
+		}
+		else
+		{
+			dictionary.clear();
+			break;
+		}
+	}
+
+	if (dictionary.empty())
+	{
+		cerr << "usage: wurdd [-s SOCKET] [-j WORKERS] DICTIONARY" << endl;
+		return 2;
+	}
+
+	// clients only use the daemon if it serves the very file they asked for
+	char resolved[PATH_MAX];
+	DictStamp stamp;
+	StudentSpellCheck checker;
+	if (realpath(dictionary.c_str(), resolved) == nullptr || !statDictSource(resolved, stamp) || !checker.load(resolved))
+	{
+		cerr << "wurdd: can't load dictionary " << dictionary << endl;
+		return 1;
+	}
+
+	// the default directory is made private, and not used if it can't be
+	if (socketPath == spellSocketDir() + "/wurdd.sock" && !makePrivateDir(spellSocketDir()))
+	{
+		cerr << "wurdd: " << spellSocketDir() << " isn't a directory only this user can get into" << endl;
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	SpellServer server(checker, resolved, stamp, workers);
+	if (!server.listen(socketPath))
+	{
+		return 1;
+	}
+	server.run();
+	return 0;
+}